@@ -30,11 +30,17 @@
 #include "gui_dlg.h"
 
 #include "config_file.h"
+#include "notch.h"
+#include "real2cplx.h"
+#include "settle.h"
+#include "latency.h"
+#include "standby.h"
 
 #define LIBRTL_EXPORTS 1
 #include "ExtIO_RTL.h"
 
 #include <atomic>
+#include <chrono>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -43,6 +49,7 @@
 #include <tchar.h>
 #endif
 
+#include <cfgmgr32.h>
 #include <new>
 
 #define ALWAYS_PCMU8  1
@@ -121,14 +128,64 @@ static bool GUIDebugConnection = false;
 static volatile HANDLE RX_thread_handle = INVALID_HANDLE_VALUE;
 static volatile HANDLE ConnCheck_thread_handle = INVALID_HANDLE_VALUE;
 
+// device enumeration in background: refreshed at USB notifications or on request
+static std::atomic_bool terminate_DevEnum_Thread = false;
+static std::atomic_bool DevEnum_Thread_running = false;
+static volatile HANDLE DevEnum_thread_handle = INVALID_HANDLE_VALUE;
+static HANDLE DevEnum_event = NULL;
+
+// automatic reconnect after an unexpected end of streaming - e.g. a USB glitch.
+//   seconds to keep trying: 0 == off, -1 == forever
+std::atomic_int reconnect_timeout_s = 300;
+static std::atomic_bool terminate_Reconnect_Thread = false;
+static volatile HANDLE Reconnect_thread_handle = INVALID_HANDLE_VALUE;
+static HANDLE Reconnect_event = NULL;   // auto-reset: USB device change or termination
+static RtlDeviceInfo reconnect_device;  // the lost device
+static int64_t reconnect_sample_count = 0;
+static std::chrono::steady_clock::time_point reconnect_lost_time;
+static constexpr DWORD RECONNECT_MIN_BACKOFF_MS = 250;
+static constexpr DWORD RECONNECT_MAX_BACKOFF_MS = 8000;
+
+// for measurement of StartHW() until first received samples
+static std::chrono::steady_clock::time_point start_hw_time;
+
+// warm stop: StopHW() keeps USB streaming, only delivery to the host is stopped
+std::atomic_int warm_stop = 0;
+static std::atomic_bool RX_deliver = false;   // gate for the host callback
+static std::atomic_bool RX_resume = false;    // RX thread: reset processing state before next delivery
+static uint32_t RX_buffer_len = 0;            // buffer length of running rtlsdr_read_async()
+
+// hot standby: the standby device delivers, since the failover - until StopHW()
+static std::atomic_bool standby_active = false;
+static std::atomic_bool standby_first_block = false;  // standby RX thread: reset processing state
+static std::atomic_uint standby_clip = 0;         // clip metric of the standby's last block
+static const char* failover_reason = "";
+static std::chrono::steady_clock::time_point failover_time;
+static constexpr unsigned FAILOVER_CLIP_BLOCKS = 4;
+
+// received sample index of the first block at the new samplerate. -1 == no switch pending
+static std::atomic_int64_t srate_switch_at = -1;
+
 void RX_ThreadProc(void* param);
-int Start_RX_Thread();
+int Start_RX_Thread(int64_t first_sample_idx = 0);   // continues the sample count after a reconnect
 int Stop_RX_Thread();
+static bool is_RX_Thread_warm();
 
 void ConnCheck_ThreadProc(void* param);
 int Start_ConnCheck_Thread();
 int Stop_ConnCheck_Thread();
 
+void DevEnum_ThreadProc(void* param);
+int Start_DevEnum_Thread();
+int Stop_DevEnum_Thread();
+
+void Reconnect_ThreadProc(void* param);
+int Start_Reconnect_Thread();
+int Stop_Reconnect_Thread();
+
+static bool failover_to_standby(const char* reason);
+static void standby_rx_callback(RtlDevCtx& ctx, const uint8_t* iq, uint32_t n_iq_pairs, int64_t first_idx, void* user);
+
 
 /* ExtIO Callback */
 pfnExtIOCallback gpfnExtIOCallbackPtr = NULL;
@@ -181,7 +238,13 @@ static int nearestSrateIdx(int srate)
 extern "C"
 bool  LIBRTL_API EXTIO_CALL InitHW(char* name, char* model, int& type)
 {
+  char acMsg[256];
   init_toml_config();     // process as early as possible, but that depends on SDR software
+  {
+    bool from_cache = false;
+    const unsigned us = get_config_load_us(from_cache);
+    SDRLG(extHw_MSG_DEBUG, "InitHW(): band config loaded from %s in %u us", from_cache ? "cache" : "toml", us);
+  }
 
   const BandAction::Band_Info bi = get_band_info();
   switch (bi)
@@ -235,6 +298,11 @@ extern "C"
 bool  LIBRTL_API EXTIO_CALL OpenHW()
 {
   SDRLOG(extHw_MSG_DEBUG, "OpenHW()");
+  gui_measure_ready(std::chrono::steady_clock::now());
+  // device list and tuner type from the caches: the GUI is complete, before
+  //   the device is opened and its tuner probed
+  retrieve_devices();
+  preset_tuner_from_cache();
   CreateGUI();
 
   bool r = open_selected_rtl_device();
@@ -250,148 +318,299 @@ bool  LIBRTL_API EXTIO_CALL OpenHW()
   }
   post_update_gui_init();  // post_update_gui_fields();
 
+  // hot standby: open and tuned now - not at failover
+  if (standby_open(RtlOpenDevice.serial))
+    standby_sync();
+
+  Start_Control_Thread();
   Start_ConnCheck_Thread();
+  Start_DevEnum_Thread();
+  start_config_watch();
 
   return true;
 }
 
 
-static CtrlFlagT _setHwLO_check_bands(int64_t freq)
+// band action, resolved for the opened tuner: indices into the tuner's gain,
+//   bandwidth and samplerate tables. flags tells, which fields are set
+struct CompiledBandAction
 {
-  static std::string last_band_name{};
-  static char acMsg[256];
-  static bool last_was_undefined_band = false;
-  CtrlFlagT changed_flags = 0;
-  const BandAction::Band_Info bi = get_band_info();
-  if (bi != BandAction::Band_Info::info_ok)
-    return changed_flags;
+  bool valid;
+  CtrlFlagT flags;
+  unsigned gpio_mask;   // bit k: GPIO[k] is set
+  int sampling_mode;
+  int rtl_agc;
+  int tuner_rf_agc;
+  int tuner_if_agc;
+  int USB_sideband;
+  int rf_gain;
+  int if_gain_idx;
+  int if_gain_val;
+  int srate_idx;
+  int tuner_bw;
+  int GPIO[ControlVars::NUM_GPIO_BUTTONS];
+};
 
-  if (nxt.LO_freq.load() == freq && !last_band_name.empty())
-    return changed_flags;
+// per band table and tuner: each band gets compiled at its first entry
+static std::vector<CompiledBandAction> compiled_bands;
+static unsigned compiled_generation = 0;
+static int compiled_tuner = -1;
 
-  const BandAction* new_band = update_band_action(double(freq));
-  if (!new_band)
+static void compile_band_action(const BandAction& ba, CompiledBandAction& cb)
+{
+  memset(&cb, 0, sizeof(cb));
+  cb.valid = true;
+  cb.if_gain_idx = -1;
+  const bool tuner_known = GotTunerInfo && tunerNo < tuners::N;
+
+  if (ba.sampling_mode)
   {
-    if (!last_was_undefined_band)
-    {
-      snprintf(band_disp_text, 255, "Band: undefined");
-      last_was_undefined_band = true;
-      update_band_text.store(true);
-      SDRLG(extHw_MSG_LOG, "new band name: %s", band_disp_text);
-    }
-    return changed_flags;
+    const char m = ba.sampling_mode.value();
+    cb.sampling_mode = (m == 'I') ? 1 : (m == 'Q') ? 2 : 0;
+    cb.flags |= CtrlFlags::sampling_mode;  // direct sampling mode;
   }
 
-  // we are now moving into a new band with some defined action(s)
-  const BandAction& ba = *new_band;   // have a shorter alias
-
-  const std::string& new_band_name = (ba.name.has_value()) ? ba.name.value() : ba.id;
-  const bool update_band_name = is_gui_available() && (last_band_name.empty() || new_band_name != last_band_name);
-  if (update_band_name)
+  if (ba.samplerate)
   {
-    last_band_name = new_band_name;
-    last_was_undefined_band = false;
-    snprintf(band_disp_text, 255, "Band: %s", new_band_name.c_str());
-    update_band_text.store(true);
-    SDRLG(extHw_MSG_LOG, "new band name: '%s'", band_disp_text);
+    cb.srate_idx = nearestSrateIdx(int(ba.samplerate.value()));
+    cb.flags |= CtrlFlags::srate;
   }
 
-  if (ba.sampling_mode)
+  if (ba.tuner_bandwidth && n_bandwidths)
   {
-    if (ba.sampling_mode.value() == 'I')
-      nxt.sampling_mode = 1;
-    else if (ba.sampling_mode.value() == 'Q')
-      nxt.sampling_mode = 2;
-    else if (ba.sampling_mode.value() == 'C')
-      nxt.sampling_mode = 0;
-    changed_flags |= CtrlFlags::sampling_mode;  // direct sampling mode;
+    // bandwidths[] are in kHz. 0 == automatic
+    const int bw_khz = int(ba.tuner_bandwidth.value() / 1000.0);
+    cb.tuner_bw = (bw_khz > 0) ? bandwidths[nearestBwIdx(bw_khz)] : 0;
+    cb.flags |= CtrlFlags::tuner_bandwidth;
   }
 
   if (ba.rtl_digital_agc)
   {
-    nxt.rtl_agc = ba.rtl_digital_agc.value() ? 1 : 0;
-    changed_flags |= CtrlFlags::rtl_agc;  // rtl agc
+    cb.rtl_agc = ba.rtl_digital_agc.value() ? 1 : 0;
+    cb.flags |= CtrlFlags::rtl_agc;  // rtl agc
   }
 
   if (ba.tuner_rf_agc)
   {
-    nxt.tuner_rf_agc = ba.tuner_rf_agc.value() ? 1 : 0;
-    changed_flags |= CtrlFlags::rf_agc;
+    cb.tuner_rf_agc = ba.tuner_rf_agc.value() ? 1 : 0;
+    cb.flags |= CtrlFlags::rf_agc;
   }
 
   if (ba.tuner_if_agc)
   {
-    nxt.tuner_if_agc = ba.tuner_if_agc.value() ? 1 : 0;
-    changed_flags |= CtrlFlags::if_agc_gain;
+    cb.tuner_if_agc = ba.tuner_if_agc.value() ? 1 : 0;
+    cb.flags |= CtrlFlags::if_agc_gain;
   }
 
   if (ba.tuning_sideband)
   {
-    if (ba.tuning_sideband.value() == 'L')
-      nxt.USB_sideband = 0;
-    else if (ba.tuning_sideband.value() == 'U')
-      nxt.USB_sideband = 1;
-    changed_flags |= CtrlFlags::tuner_sideband;
-  }
-
-  if (ba.gpio_button0)
-    nxt.GPIO[0] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button1)
-    nxt.GPIO[1] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button2)
-    nxt.GPIO[2] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button3)
-    nxt.GPIO[3] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button4)
-    nxt.GPIO[4] = ba.gpio_button0.value() ? 1 : 0;
-  if (ba.gpio_button0 || ba.gpio_button1 || ba.gpio_button2 || ba.gpio_button3 || ba.gpio_button4)
-    changed_flags |= CtrlFlags::gpio;
+    cb.USB_sideband = (ba.tuning_sideband.value() == 'U') ? 1 : 0;
+    cb.flags |= CtrlFlags::tuner_sideband;
+  }
+
+  const std::optional<bool>* gpio_buttons[ControlVars::NUM_GPIO_BUTTONS] = {
+    &ba.gpio_button0, &ba.gpio_button1, &ba.gpio_button2, &ba.gpio_button3, &ba.gpio_button4
+  };
+  for (unsigned k = 0; k < ControlVars::NUM_GPIO_BUTTONS; ++k)
+  {
+    if (!*gpio_buttons[k])
+      continue;
+    cb.GPIO[k] = gpio_buttons[k]->value() ? 1 : 0;
+    cb.gpio_mask |= (1U << k);
+    cb.flags |= CtrlFlags::gpio;
+  }
 
   if (ba.tuner_rf_gain_db)
   {
-    nxt.tuner_rf_agc = 0;    // also deactivate AGC
-    const int rf_gain_tenth_db = int(ba.tuner_rf_gain_db.value() * 10.0);
-    if (GotTunerInfo && tunerNo < tuners::N)
+    cb.tuner_rf_agc = 0;    // also deactivate AGC
+    if (tuner_known)
     {
+      const int rf_gain_tenth_db = int(ba.tuner_rf_gain_db.value() * 10.0);
       int gainIdx = nearestGainIdx(rf_gain_tenth_db, tuners::rf_gains[tunerNo].gain, tuners::rf_gains[tunerNo].num);
       if (gainIdx >= 0 && gainIdx < tuners::rf_gains[tunerNo].num)
-        nxt.rf_gain = tuners::rf_gains[tunerNo].gain[gainIdx];
+      {
+        // table gains can be negative: the flag marks a resolved gain
+        cb.rf_gain = tuners::rf_gains[tunerNo].gain[gainIdx];
+        cb.flags |= CtrlFlags::rf_gain;
+      }
     }
-    changed_flags |= (CtrlFlags::rf_agc | CtrlFlags::rf_gain);
+    cb.flags |= CtrlFlags::rf_agc;
   }
-  else if (ba.tuner_rf_gain_db && GotTunerInfo && tunerNo < tuners::N)
+
+  if (ba.tuner_if_gain_db)
   {
-    nxt.tuner_rf_agc = 0;    // also deactivate AGC
-    const int rf_gain_tenth_db = int(ba.tuner_rf_gain_db.value() * 10.0);
-    int gainIdx = nearestGainIdx(rf_gain_tenth_db, tuners::rf_gains[tunerNo].gain, tuners::rf_gains[tunerNo].num);
-    SetAttenuator(gainIdx);
+    cb.tuner_if_agc = 0;    // also deactivate AGC
+    if (tuner_known)
+    {
+      const int if_gain_tenth_db = int(ba.tuner_if_gain_db.value() * 10.0);
+      int gainIdx = nearestGainIdx(if_gain_tenth_db, tuners::if_gains[tunerNo].gain, tuners::if_gains[tunerNo].num);
+      if (gainIdx >= 0 && gainIdx < tuners::if_gains[tunerNo].num)
+      {
+        cb.if_gain_idx = gainIdx;
+        cb.if_gain_val = tuners::if_gains[tunerNo].gain[gainIdx];
+      }
+    }
+    cb.flags |= CtrlFlags::if_agc_gain;
   }
+}
 
-  if (ba.tuner_if_gain_db)
+static const CompiledBandAction& get_compiled_band_action(const BandAction& ba)
+{
+  // tuner or band table changed? then all compiled bands are stale
+  const int tuner = GotTunerInfo ? int(tunerNo.load()) : -1;
+  if (ba.generation != compiled_generation || tuner != compiled_tuner)
+  {
+    compiled_bands.clear();
+    compiled_generation = ba.generation;
+    compiled_tuner = tuner;
+  }
+  if (ba.index >= compiled_bands.size())
+    compiled_bands.resize(ba.index + 1, CompiledBandAction{});  // valid = false
+  CompiledBandAction& cb = compiled_bands[ba.index];
+  if (!cb.valid)
+    compile_band_action(ba, cb);
+  return cb;
+}
+
+// returns the flags of the values, which differ from the current ones:
+//   adjacent bands often share most settings
+static CtrlFlagT apply_compiled_band_action(const CompiledBandAction& cb)
+{
+  CtrlFlagT diff = 0;
+  auto set = [&diff](CtrlVar<int>& var, int val, CtrlFlagT flag) {
+    if (var.load() != val)
+    {
+      var.store(val);
+      diff |= flag;
+    }
+  };
+
+  const CtrlFlagT f = cb.flags;
+  if (f & CtrlFlags::sampling_mode)
+    set(nxt.sampling_mode, cb.sampling_mode, CtrlFlags::sampling_mode);
+  if (f & CtrlFlags::srate)
+    set(nxt.srate_idx, cb.srate_idx, CtrlFlags::srate);
+  if (f & CtrlFlags::tuner_bandwidth)
+    set(nxt.tuner_bw, cb.tuner_bw, CtrlFlags::tuner_bandwidth);
+  if (f & CtrlFlags::rtl_agc)
+    set(nxt.rtl_agc, cb.rtl_agc, CtrlFlags::rtl_agc);
+  if (f & CtrlFlags::rf_agc)
+    set(nxt.tuner_rf_agc, cb.tuner_rf_agc, CtrlFlags::rf_agc);
+  if (f & CtrlFlags::rf_gain)
+    set(nxt.rf_gain, cb.rf_gain, CtrlFlags::rf_gain);
+  if (f & CtrlFlags::if_agc_gain)
+  {
+    set(nxt.tuner_if_agc, cb.tuner_if_agc, CtrlFlags::if_agc_gain);
+    if (cb.if_gain_idx >= 0)
+    {
+      set(nxt.if_gain_idx, cb.if_gain_idx, CtrlFlags::if_agc_gain);
+      set(nxt.if_gain_val, cb.if_gain_val, CtrlFlags::if_agc_gain);
+    }
+  }
+  if (f & CtrlFlags::tuner_sideband)
+    set(nxt.USB_sideband, cb.USB_sideband, CtrlFlags::tuner_sideband);
+  for (unsigned k = 0; k < ControlVars::NUM_GPIO_BUTTONS; ++k)
+    if (cb.gpio_mask & (1U << k))
+      set(nxt.GPIO[k], cb.GPIO[k], CtrlFlags::gpio);
+  return diff;
+}
+
+
+// resolves the band transition - without storing into nxt.
+//   returns the new band's action, nullptr == no transition
+static const CompiledBandAction* _setHwLO_check_bands(int64_t freq, bool& band_name_changed)
+{
+  static std::string last_band_name{};
+  static char acMsg[256];
+  static bool last_was_undefined_band = false;
+  static bool band_notches = false;   // notches of a band are active
+  band_name_changed = false;
+  const BandAction::Band_Info bi = get_band_info();
+  if (bi != BandAction::Band_Info::info_ok)
   {
-    nxt.tuner_if_agc = 0;    // also deactivate AGC
-    int if_gain_tenth_db = int(ba.tuner_if_gain_db.value() * 10.0);
-    if (GotTunerInfo && tunerNo < tuners::N)
+    // band plan disabled or broken: its notches don't apply anymore
+    if (band_notches)
     {
-      nxt.if_gain_idx = nearestGainIdx(if_gain_tenth_db, tuners::if_gains[tunerNo].gain, tuners::if_gains[tunerNo].num);
-      if (nxt.if_gain_idx >= 0 && nxt.if_gain_idx < tuners::if_gains[tunerNo].num)
-        nxt.if_gain_val = tuners::if_gains[tunerNo].gain[nxt.if_gain_idx];
+      notch_set_frequencies(nullptr, 0, notch::DEFAULT_BW);
+      band_notches = false;
+    }
+    return nullptr;
+  }
 
+  if (nxt.LO_freq.load() == freq && !last_band_name.empty())
+    return nullptr;
+
+  bool left_all_bands = false;
+  const BandAction* new_band = update_band_action(double(freq), left_all_bands);
+  if (!new_band)
+  {
+    if (!left_all_bands)
+      return nullptr;   // no transition
+    if (!last_was_undefined_band)
+    {
+      snprintf(band_disp_text, 255, "Band: undefined");
+      last_was_undefined_band = true;
+      update_band_text.store(true);
+      SDRLG(extHw_MSG_LOG, "new band name: %s", band_disp_text);
+    }
+    if (band_notches)
+    {
+      notch_set_frequencies(nullptr, 0, notch::DEFAULT_BW);
+      band_notches = false;
     }
-    changed_flags |= CtrlFlags::if_agc_gain;
+    return nullptr;
   }
-  else if (ba.tuner_if_gain_db && GotTunerInfo && tunerNo < tuners::N)
+
+  // we are now moving into a new band with some defined action(s)
+  const BandAction& ba = *new_band;   // have a shorter alias
+
+  const std::string& new_band_name = (ba.name.has_value()) ? ba.name.value() : ba.id;
+  const bool update_band_name = is_gui_available()
+    && (last_band_name.empty() || last_was_undefined_band || new_band_name != last_band_name);
+  if (update_band_name)
   {
-    nxt.tuner_if_agc = 0;    // also deactivate AGC
-    const int if_gain_tenth_db = int(ba.tuner_if_gain_db.value() * 10.0);
+    last_band_name = new_band_name;
+    last_was_undefined_band = false;
+    snprintf(band_disp_text, 255, "Band: %s", new_band_name.c_str());
+    update_band_text.store(true);
+    SDRLG(extHw_MSG_LOG, "new band name: '%s'", band_disp_text);
+    band_name_changed = true;
+  }
+
+  // spur notches are defined per band: a band without notch_frequencies disables them
+  notch_set_frequencies(ba.notch_frequencies.data(), unsigned(ba.notch_frequencies.size()),
+    ba.notch_bandwidth.value_or(notch::DEFAULT_BW));
+  band_notches = !ba.notch_frequencies.empty();
+
+  // resolved once per band and tuner. only the differences get commanded
+  return &get_compiled_band_action(ba);
+}
+
 
-    int if_gain_idx = nearestGainIdx(if_gain_tenth_db, tuners::if_gains[tunerNo].gain, tuners::if_gains[tunerNo].num);
-    ExtIoSetMGC(if_gain_idx);
+// band transition and new LO. returns the flags of the changed values
+static CtrlFlagT _setHwLO(int64_t freq)
+{
+  CtrlFlagT changed_flags = 0;
+  bool band_name_changed = false;
+  {
+    // the writer lock serializes the band state here - and makes the single
+    //   band_table_hazard slot safe: one reader at a time. resolving the band
+    //   (logging, notch, compilation) is outside the batch: snapshot() doesn't spin for it
+    ControlVars::WriterLock writer(nxt);
+    const CompiledBandAction* cb = _setHwLO_check_bands(freq, band_name_changed);
+    // publish the band transition together with the new LO
+    ControlVars::WriteBatch batch(nxt);
+    if (cb)
+      changed_flags = apply_compiled_band_action(*cb);
+    nxt.LO_freq.store(freq); // +nxt.band_center_LO_delta;
   }
 
+  // host callbacks: outside the lock - the host may re-enter
+  if ((changed_flags & CtrlFlags::srate) && !ThreadStreamToSDR.load())
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);  // else at first block with new rate
 
   //if (!changed_flags.is_empty())  // update GUI fields on changes
-  if (changed_flags || update_band_name)
+  if (changed_flags || band_name_changed)
     post_update_gui_fields();
 
   //if (any(changed_flags))
@@ -405,8 +624,7 @@ static CtrlFlagT _setHwLO_check_bands(int64_t freq)
 extern "C"
 long LIBRTL_API EXTIO_CALL SetHWLO(long freq)
 {
-  CtrlFlagT change_flags = _setHwLO_check_bands(freq);
-  nxt.LO_freq.store(freq); // +nxt.band_center_LO_delta;
+  const CtrlFlagT change_flags = _setHwLO(freq);
   SDRLOG(extHw_MSG_DEBUG, "SetHWLO() -> trigger_control()");
   trigger_control(change_flags | CtrlFlags::freq);
   return 0;
@@ -416,8 +634,7 @@ long LIBRTL_API EXTIO_CALL SetHWLO(long freq)
 extern "C"
 int64_t LIBRTL_API EXTIO_CALL SetHWLO64(int64_t freq)
 {
-  CtrlFlagT change_flags = _setHwLO_check_bands(freq);
-  nxt.LO_freq.store(freq); // +nxt.band_center_LO_delta;
+  const CtrlFlagT change_flags = _setHwLO(freq);
   SDRLOG(extHw_MSG_DEBUG, "SetHWLO64() -> trigger_control()");
   trigger_control(change_flags | CtrlFlags::freq);
   return 0;
@@ -454,7 +671,9 @@ int LIBRTL_API EXTIO_CALL StartHW(long freq)
 {
   char acMsg[256];
   SDRLG(extHw_MSG_DEBUG, "StartHW() with device handle 0x%p", RtlSdrDev);
+  start_hw_time = std::chrono::steady_clock::now();
 
+  Stop_Reconnect_Thread();
   Stop_ConnCheck_Thread();
 
   while (!RtlSdrDev || !is_device_handle_valid())
@@ -500,14 +719,36 @@ int LIBRTL_API EXTIO_CALL StartHW(long freq)
     SDRLOG(extHw_MSG_DEBUG, "StartHW(): using 'other' sample type - NOT PCMU8 or PCM16!");
 
   ThreadStreamToSDR = true;
-  if (Start_RX_Thread() < 0)
+  if (is_RX_Thread_warm())
   {
-    SDRLOG(extHw_MSG_ERROR, "StartHW(): Error to start streaming thread");
-    return -1;
+    // USB is still streaming since warm StopHW(): just open the gate
+    RX_resume = true;
+    RX_deliver = true;
+    SDRLOG(extHw_MSG_DEBUG, "StartHW(): warm start - resuming delivery of running stream");
+  }
+  else
+  {
+    if (RX_thread_handle != INVALID_HANDLE_VALUE)
+      Stop_RX_Thread();   // warm, but with other buffer size
+    if (Start_RX_Thread() < 0)
+    {
+      SDRLOG(extHw_MSG_ERROR, "StartHW(): Error to start streaming thread");
+      return -1;
+    }
+    SDRLOG(extHw_MSG_DEBUG, "StartHW(): Started streaming thread");
+  }
+
+  if (standby_warm.load() && standby_is_open() && !standby_is_streaming())
+  {
+    if (standby_start(standby_rx_callback, uint32_t(buffer_len.load())) < 0)
+      SDRLOG(extHw_MSG_WARNING, "StartHW(): Error starting warm standby stream");
   }
-  SDRLOG(extHw_MSG_DEBUG, "StartHW(): Started streaming thread");
 
-  commandEverything = true;
+  // device kept its state since the last start? then send only the changes
+  if (!fast_start.load() || !hw_state_valid.load())
+    commandEverything = true;
+  else
+    SDRLOG(extHw_MSG_DEBUG, "StartHW(): fast start - commanding changes only");
   SetHWLO(freq);
 
   DisableGUIControlsAtStart();
@@ -543,6 +784,8 @@ long LIBRTL_API EXTIO_CALL GetHWSR()
 #if ( FULL_DECIMATION )
   sr /= nxt.decimation;
 #endif
+  if (real2cplx_active(nxt.sampling_mode))
+    sr /= 2;
   return sr;
 }
 
@@ -556,6 +799,8 @@ int LIBRTL_API EXTIO_CALL ExtIoGetSrates(int srate_idx, double* samplerate)
 #else
     * samplerate = rates::tab[srate_idx].value;
 #endif
+    if (real2cplx_active(nxt.sampling_mode))
+      *samplerate /= 2.0;
     return 0;
   }
   return 1; // ERROR
@@ -568,6 +813,8 @@ long LIBRTL_API EXTIO_CALL ExtIoGetBandwidth(int srate_idx)
   {
     // ~ 3/4 of spectrum usable
     long bw = rates::tab[srate_idx].valueInt * 3L / (nxt.decimation * 4L);
+    if (real2cplx_active(nxt.sampling_mode))
+      bw /= 2;
     if (nxt.tuner_bw && nxt.tuner_bw * 1000L < bw)
       bw = nxt.tuner_bw * 1000L;
     return bw;
@@ -590,7 +837,9 @@ int  LIBRTL_API EXTIO_CALL ExtIoSetSrate(int srate_idx)
     gui_SetSrate(srate_idx);
     nxt.srate_idx = srate_idx;
     trigger_control(CtrlFlags::srate);
-    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);  // Signal application
+    // while streaming, RX thread signals at the first block with the new samplerate
+    if (!ThreadStreamToSDR.load())
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);  // Signal application
     return 0;
   }
   return 1; // ERROR
@@ -659,8 +908,11 @@ int  LIBRTL_API EXTIO_CALL ExtIoSetMGC(int mgc_idx)
 
   gui_SetMGC(mgc_idx);
 
-  nxt.if_gain_val = if_gains[mgc_idx];
-  nxt.if_gain_idx = mgc_idx;
+  {
+    ControlVars::WriteBatch batch(nxt);
+    nxt.if_gain_val = if_gains[mgc_idx];
+    nxt.if_gain_idx = mgc_idx;
+  }
   SDRLOG(extHw_MSG_DEBUG, "ExtIoSetMGC() -> trigger_control()");
   trigger_control(CtrlFlags::if_agc_gain);
   return 0;
@@ -792,6 +1044,19 @@ enum class Setting {
   , RTL_AAGC_KRF3
   , RTL_AAGC_KRF4
 
+  , DIRECT_SAMPLING_R2C
+  , MIN_RETUNE_INTERVAL_MS
+  , SETTLE_MODE
+  , SETTLE_TIME_MS
+  , LATENCY_DUMP_FILE
+  , CONTROL_DIAGNOSTICS
+  , FAST_START
+  , WARM_STOP
+  , RECONNECT_TIMEOUT
+  , STANDBY_SERIAL
+  , STANDBY_WARM
+  , STANDBY_CLIP_PERMILLE
+
   , NUM   // Last One == Amount
 };
 
@@ -1048,6 +1313,55 @@ int   LIBRTL_API EXTIO_CALL ExtIoGetSetting(int idx, char* description, char* va
     snprintf(value, 1024, "%d", nxt.rtl_aagc_krf[3].load());
     return 0;
 
+  case Setting::DIRECT_SAMPLING_R2C:
+    snprintf(description, 1024, "%s", "Direct Sampling: 0 = deliver I/Q as received, 1 = convert real ADC branch to complex at half samplerate");
+    snprintf(value, 1024, "%d", real2cplx_enable.load());
+    return 0;
+  case Setting::MIN_RETUNE_INTERVAL_MS:
+    snprintf(description, 1024, "%s", "Minimum interval between two retunes in ms. 0 = no limit. Frequency changes in between are merged");
+    snprintf(value, 1024, "%d", min_retune_interval_ms.load());
+    return 0;
+  case Setting::SETTLE_MODE:
+    snprintf(description, 1024, "%s", "Samples in settling window after retune or gain change: 0 = deliver, 1 = zero, 2 = drop blocks");
+    snprintf(value, 1024, "%d", settle_mode.load());
+    return 0;
+  case Setting::SETTLE_TIME_MS:
+    snprintf(description, 1024, "%s", "Settling window in ms. -1 = tuner specific default");
+    snprintf(value, 1024, "%d", settle_time_ms.load());
+    return 0;
+  case Setting::LATENCY_DUMP_FILE:
+    snprintf(description, 1024, "%s", "Filename for latency histograms of the tuner commands - written at Stop. empty = no dump");
+    snprintf(value, 1024, "%s", latency_dump_fn);
+    return 0;
+  case Setting::CONTROL_DIAGNOSTICS:
+    snprintf(description, 1024, "%s", "Diagnostic mode: 1 = read back tuner state for the log (additional USB transfers), 0 = log written values");
+    snprintf(value, 1024, "%d", control_diagnostics.load());
+    return 0;
+  case Setting::FAST_START:
+    snprintf(description, 1024, "%s", "Fast start: 1 = send only changes at StartHW(), when device kept its state. 0 = always send all");
+    snprintf(value, 1024, "%d", fast_start.load());
+    return 0;
+  case Setting::WARM_STOP:
+    snprintf(description, 1024, "%s", "Warm stop: 1 = keep USB streaming at StopHW() and discard the samples, for fast restart. 0 = stop streaming");
+    snprintf(value, 1024, "%d", warm_stop.load());
+    return 0;
+  case Setting::RECONNECT_TIMEOUT:
+    snprintf(description, 1024, "%s", "Reconnect after USB loss while streaming: seconds to retry. 0 = off (stop the host), -1 = forever");
+    snprintf(value, 1024, "%d", reconnect_timeout_s.load());
+    return 0;
+  case Setting::STANDBY_SERIAL:
+    snprintf(description, 1024, "%s", "Hot standby: serial of a second device, kept open and tuned like the primary - for failover. empty = off");
+    snprintf(value, 1024, "%s", standby_serial);
+    return 0;
+  case Setting::STANDBY_WARM:
+    snprintf(description, 1024, "%s", "Hot standby: 1 = standby streams all the time, samples discarded - failover within one block. 0 = starts streaming at failover");
+    snprintf(value, 1024, "%d", standby_warm.load());
+    return 0;
+  case Setting::STANDBY_CLIP_PERMILLE:
+    snprintf(description, 1024, "%s", "Hot standby: failover, when this per mille of the primary's ADC samples clip - requires warm standby. 0 = only at RX failure");
+    snprintf(value, 1024, "%d", standby_clip_permille.load());
+    return 0;
+
   default:
     return -1;  // ERROR
   }
@@ -1262,6 +1576,46 @@ void  LIBRTL_API EXTIO_CALL ExtIoSetSetting(int idx, const char* value)
   case Setting::RTL_AAGC_KRF4:
     nxt.rtl_aagc_krf[3] = atoi(value);
     break;
+
+  case Setting::DIRECT_SAMPLING_R2C:
+    real2cplx_enable = atoi(value) ? 1 : 0;
+    break;
+  case Setting::MIN_RETUNE_INTERVAL_MS:
+    min_retune_interval_ms = (atoi(value) < 0) ? 0 : atoi(value);
+    break;
+  case Setting::SETTLE_MODE:
+    settle_mode = (atoi(value) < 0 || atoi(value) > 2) ? 1 : atoi(value);
+    break;
+  case Setting::SETTLE_TIME_MS:
+    settle_time_ms = (atoi(value) < 0) ? -1 : atoi(value);
+    break;
+  case Setting::LATENCY_DUMP_FILE:
+    snprintf(latency_dump_fn, sizeof(latency_dump_fn) - 1, "%s", value);
+    latency_dump_fn[sizeof(latency_dump_fn) - 1] = 0;
+    break;
+  case Setting::CONTROL_DIAGNOSTICS:
+    control_diagnostics = atoi(value) ? 1 : 0;
+    break;
+  case Setting::FAST_START:
+    fast_start = atoi(value) ? 1 : 0;
+    break;
+  case Setting::WARM_STOP:
+    warm_stop = atoi(value) ? 1 : 0;
+    break;
+  case Setting::RECONNECT_TIMEOUT:
+    reconnect_timeout_s = (atoi(value) < 0) ? -1 : atoi(value);
+    break;
+  case Setting::STANDBY_SERIAL:
+    snprintf(standby_serial, sizeof(standby_serial) - 1, "%s", value);
+    standby_serial[sizeof(standby_serial) - 1] = 0;
+    break;
+  case Setting::STANDBY_WARM:
+    standby_warm = atoi(value) ? 1 : 0;
+    break;
+  case Setting::STANDBY_CLIP_PERMILLE:
+    tempInt = atoi(value);
+    standby_clip_permille = (tempInt < 0) ? 0 : (tempInt > 1000) ? 1000 : tempInt;
+    break;
   }
 }
 
@@ -1271,18 +1625,43 @@ void LIBRTL_API EXTIO_CALL StopHW()
 {
   SDRLOG(extHw_MSG_DEBUG, "StopHW()");
   ThreadStreamToSDR = false;
-  Stop_RX_Thread();
+  Stop_Reconnect_Thread();
+  // failover ends: the next start is with the primary
+  standby_stop();
+  standby_active = false;
+  if (warm_stop.load() && is_RX_Thread_warm())
+  {
+    // keep USB transfers alive: RX thread discards the samples.
+    //   ConnCheck is not required: RX thread notices a lost device
+    RX_deliver = false;
+    SDRLOG(extHw_MSG_DEBUG, "StopHW(): warm stop - USB streaming continues");
+  }
+  else
+    Stop_RX_Thread();
+  if (latency_dump_fn[0])
+    latency::dump(latency_dump_fn);
   EnableGUIControlsAtStop();
-  Start_ConnCheck_Thread();
+  if (RX_thread_handle == INVALID_HANDLE_VALUE)
+    Start_ConnCheck_Thread();
 }
 
 extern "C"
 void LIBRTL_API EXTIO_CALL CloseHW()
 {
   SDRLOG(extHw_MSG_DEBUG, "CloseHW()");
+  stop_config_watch();
+  ThreadStreamToSDR = false;
+  Stop_Reconnect_Thread();
+  Stop_ConnCheck_Thread();  // might wait for USB notifications
+  Stop_DevEnum_Thread();
   ThreadStreamToSDR = false;
   Stop_RX_Thread();
+  standby_active = false;
+  Stop_Control_Thread();
+  standby_close();
   close_rtl_device();
+  if (latency_dump_fn[0])
+    latency::dump(latency_dump_fn);
   DestroyGUI();
 }
 
@@ -1327,17 +1706,25 @@ struct CallbackContext
     receiveBufferIdx = 0;
     printCallbackLen = true;
     acMsg[0] = 0;
+    r2cActive = false;
+    r2cFill = 0;
+    waitFirstSample = true;
+    clipBlocks = 0;
   }
 
   char acMsg[256];
   int receiveBufferIdx;
   bool printCallbackLen;
+  bool r2cActive;   // real to complex conversion for direct sampling
+  int r2cFill;      // converted I/Q pairs in current output buffer
+  bool waitFirstSample;   // measure StartHW() until first received block
+  unsigned clipBlocks;    // consecutive blocks over the standby's clip threshold
 };
 
 static CallbackContext cb_ctx;
 
 
-int Start_RX_Thread()
+int Start_RX_Thread(int64_t first_sample_idx)
 {
   //If already running, exit
   if (RX_thread_handle != INVALID_HANDLE_VALUE)
@@ -1379,6 +1766,13 @@ int Start_RX_Thread()
   }
 
   cb_ctx.reset();
+  notch_reset_state();
+  real2cplx_reset();
+  settle_reset(uint32_t(buffer_len.load() / 2), first_sample_idx);
+  RX_resume = false;
+  srate_switch_at = -1;   // sample count restarts
+  RX_deliver = true;
+  RX_buffer_len = buffer_len.load();
 
   SDRLOG(extHw_MSG_DEBUG, "Starting ASYNC receive thread ..");
   RX_thread_handle = (HANDLE)_beginthread(RX_ThreadProc, 0, NULL);
@@ -1392,11 +1786,133 @@ int Start_RX_Thread()
   return 0;
 }
 
-static void RtlSdrCallback(unsigned char* buf, uint32_t len, void* ctx)
+bool rx_mark_srate_change()
 {
-  if (!buf || !ctx || !gpfnExtIOCallbackPtr || terminate_RX_Thread.load() || len != buffer_len.load())
+  if (!RX_deliver.load())
+    return false;
+  // the transfers in flight are (mostly) at the old rate: switch with the first block,
+  //   which is received completely at the new rate. the block containing the switch is
+  //   delivered as old rate - the settling window blanks it
+  srate_switch_at = rx_block_after_change();
+  return true;
+}
+
+// RX thread is streaming - and can continue with current buffer size
+static bool is_RX_Thread_warm()
+{
+  return RX_thread_handle != INVALID_HANDLE_VALUE
+    && !terminate_RX_Thread.load()
+    && RX_buffer_len == uint32_t(buffer_len.load());
+}
+
+// direct sampling: each received block gives half the I/Q pairs.
+//   collect two blocks for one callback - the host expects constant block size
+static void RtlSdrCallbackReal2Cplx(CallbackContext& c, const unsigned char* buf, uint32_t len, int sampling_mode)
+{
+  const int n_samples_per_block = len / 2;
+  const int branch = (sampling_mode == 2) ? 1 : 0;  // 1 == I-ADC, 2 == Q-ADC
+
+  if (extHWtype == exthwUSBdata16)
+  {
+    int16_t* short_ptr = pcm16_buf[c.receiveBufferIdx];
+    c.r2cFill += real2cplx_pcm16(buf, n_samples_per_block, branch, short_ptr + 2 * c.r2cFill);
+    if (c.r2cFill < n_samples_per_block)
+      return;
+    c.r2cFill = 0;
+    ++c.receiveBufferIdx;
+    if (c.receiveBufferIdx >= NUM_BUFFERS_BEFORE_CALLBACK + 1)
+      c.receiveBufferIdx = 0;
+    notch_process_pcm16(short_ptr, n_samples_per_block);
+    if (c.printCallbackLen)
+    {
+      c.printCallbackLen = false;
+      snprintf(c.acMsg, 255, "Callback() with %d converted 16 bit I/Q pairs", n_samples_per_block);
+      SDRLOG(extHw_MSG_DEBUG, c.acMsg);
+    }
+    gpfnExtIOCallbackPtr(n_samples_per_block, 0, 0, short_ptr);
+  }
+  else // if (extHWtype == exthwUSBdataU8)
+  {
+    uint8_t* pcm8_buf = rcvBuf[c.receiveBufferIdx];
+    c.r2cFill += real2cplx_u8(buf, n_samples_per_block, branch, pcm8_buf + 2 * c.r2cFill);
+    if (c.r2cFill < n_samples_per_block)
+      return;
+    c.r2cFill = 0;
+    ++c.receiveBufferIdx;
+    if (c.receiveBufferIdx >= NUM_BUFFERS_BEFORE_CALLBACK + 1)
+      c.receiveBufferIdx = 0;
+    notch_process_u8(pcm8_buf, n_samples_per_block);
+    if (c.printCallbackLen)
+    {
+      c.printCallbackLen = false;
+      snprintf(c.acMsg, 255, "Callback() with %d converted 8 Bit I/Q pairs", n_samples_per_block);
+      SDRLOG(extHw_MSG_DEBUG, c.acMsg);
+    }
+    gpfnExtIOCallbackPtr(n_samples_per_block, 0, 0, pcm8_buf);
+  }
+}
+
+// processing and delivery to the host - of the primary or, after a failover, the standby
+static void RtlSdrDeliver(CallbackContext& c, unsigned char* buf, uint32_t len)
+{
+  // warm stop: discard, but keep counting for the settling window
+  if (!RX_deliver.load())
+  {
+    rx_sample_count.fetch_add(len / 2, std::memory_order_relaxed);
+    return;
+  }
+  if (RX_resume.exchange(false))
+  {
+    // warm start: state from before StopHW() is stale
+    c.reset();
+    notch_reset_state();
+    real2cplx_reset();
+  }
+
+  const int64_t switch_at = srate_switch_at.load();
+  if (switch_at >= 0 && rx_sample_count.load(std::memory_order_relaxed) >= switch_at)
+  {
+    // first block at new samplerate: flush partial output and filter history of the old rate.
+    //   a later switch, marked meanwhile, stays pending
+    int64_t expected = switch_at;
+    srate_switch_at.compare_exchange_strong(expected, -1);
+    c.r2cFill = 0;
+    c.printCallbackLen = true;
+    notch_reset_state();
+    real2cplx_reset();
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);
+  }
+
+  if (c.waitFirstSample)
+  {
+    c.waitFirstSample = false;
+    const auto dt = std::chrono::steady_clock::now() - start_hw_time;
+    const uint64_t us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(dt).count());
+    latency::record(latency::start_to_first_sample, us);
+    snprintf(c.acMsg, 255, "StartHW() to first sample: %u ms", unsigned(us / 1000));
+    SDRLOG(extHw_MSG_DEBUG, c.acMsg);
+  }
+
+  // transients after retune / gain change: zeroed - or dropped
+  if (!settle_process_u8(buf, len / 2))
     return;
-  CallbackContext& c = *((CallbackContext*)ctx);
+
+  // after a failover: the standby's mode - the primary's 'last' isn't updated, when it's lost
+  const int sampling_mode = (standby_active.load()) ? standby_get_sampling_mode() : last.sampling_mode.load();
+  const bool r2c = real2cplx_active(sampling_mode);
+  if (r2c != c.r2cActive)
+  {
+    // mode switch: drop a partially filled buffer
+    c.r2cActive = r2c;
+    c.r2cFill = 0;
+    c.printCallbackLen = true;
+    real2cplx_reset();
+  }
+  if (r2c)
+  {
+    RtlSdrCallbackReal2Cplx(c, buf, len, sampling_mode);
+    return;
+  }
 
   const int n_samples_per_block = len / 2;
 
@@ -1409,6 +1925,7 @@ static void RtlSdrCallback(unsigned char* buf, uint32_t len, void* ctx)
       c.receiveBufferIdx = 0;
     for (uint32_t i = 0; i < len; i++)
       short_ptr[i] = int16_t(char_ptr[i]) - int16_t(128);
+    notch_process_pcm16(short_ptr, n_samples_per_block);
     if (c.printCallbackLen)
     {
       c.printCallbackLen = false;
@@ -1425,6 +1942,7 @@ static void RtlSdrCallback(unsigned char* buf, uint32_t len, void* ctx)
     if (c.receiveBufferIdx >= NUM_BUFFERS_BEFORE_CALLBACK + 1)
       c.receiveBufferIdx = 0;
     memcpy(pcm8_buf, buf, len);
+    notch_process_u8(pcm8_buf, n_samples_per_block);
     if (c.printCallbackLen)
     {
       c.printCallbackLen = false;
@@ -1435,8 +1953,99 @@ static void RtlSdrCallback(unsigned char* buf, uint32_t len, void* ctx)
   }
 }
 
+static void RtlSdrCallback(unsigned char* buf, uint32_t len, void* ctx)
+{
+  if (!buf || !ctx || !gpfnExtIOCallbackPtr || terminate_RX_Thread.load() || len != buffer_len.load())
+    return;
+  CallbackContext& c = *((CallbackContext*)ctx);
+
+  // the standby delivers: keep the primary streaming, but discard
+  if (standby_active.load())
+    return;
+
+  // overload: fail over to the warm standby - when that one is not clipping as well.
+  //   the standby is already streaming: no USB operation in this callback
+  const unsigned clip_limit = unsigned(standby_clip_permille.load());
+  if (clip_limit && RX_deliver.load() && standby_is_streaming())
+  {
+    if (clip_permille(buf, len) < clip_limit)
+      c.clipBlocks = 0;
+    else if (++c.clipBlocks >= FAILOVER_CLIP_BLOCKS && standby_clip.load() < clip_limit)
+    {
+      c.clipBlocks = 0;
+      if (failover_to_standby("primary clipping"))
+        return;
+    }
+  }
+
+  RtlSdrDeliver(c, buf, len);
+}
+
+// standby's RX thread: samples are discarded - until the failover
+static void standby_rx_callback(RtlDevCtx& ctx, const uint8_t* iq, uint32_t n_iq_pairs, int64_t first_idx, void* user)
+{
+  char acMsg[256];
+  if (standby_clip_permille.load())
+    standby_clip = clip_permille(iq, 2 * n_iq_pairs);
+  if (!standby_active.load() || !gpfnExtIOCallbackPtr || 2 * n_iq_pairs != uint32_t(buffer_len.load()))
+    return;
+  CallbackContext& c = cb_ctx;
+
+  if (standby_first_block.exchange(false))
+  {
+    // the primary's partial output and filter history don't continue here
+    c.reset();
+    c.waitFirstSample = false;
+    notch_reset_state();
+    real2cplx_reset();
+
+    const auto dt = std::chrono::steady_clock::now() - failover_time;
+    const uint64_t us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(dt).count());
+    const int srate = ctx.get_srate();
+    const unsigned block_us = (srate > 0) ? unsigned(uint64_t(n_iq_pairs) * 1000000U / unsigned(srate)) : 0;
+    latency::record(latency::failover_to_first_sample, us);
+    SDRLG(extHw_MSG_WARNING, "failover to standby '%s' (%s): %u us until first sample - block period %u us",
+      standby_get_serial(), failover_reason, unsigned(us), block_us);
+  }
+
+  // the processing writes into the buffer - e.g. settling zeroes transients
+  RtlSdrDeliver(c, const_cast<unsigned char*>(iq), 2 * n_iq_pairs);
+}
+
+// switches delivery to the standby. from the primary's RX thread only
+static bool failover_to_standby(const char* reason)
+{
+  char acMsg[256];
+  static const char* last_refusal = "";
+  if (standby_active.load() || !standby_is_open())
+    return false;
+  const auto t0 = std::chrono::steady_clock::now();
+  // not with samples of another configuration
+  const char* why = "";
+  if (!standby_can_take_over(why))
+  {
+    if (why != last_refusal)
+      SDRLG(extHw_MSG_WARNING, "no failover to standby (%s): %s", reason, why);
+    last_refusal = why;
+    return false;
+  }
+  last_refusal = "";
+  failover_time = t0;
+  failover_reason = reason;
+  standby_first_block = true;
+  standby_active = true;
+  if (!standby_is_streaming() && standby_start(standby_rx_callback, uint32_t(buffer_len.load())) < 0)
+  {
+    standby_active = false;
+    SDRLG(extHw_MSG_ERROR, "failover to standby (%s): error starting standby stream", reason);
+    return false;
+  }
+  return true;
+}
+
 int Stop_RX_Thread()
 {
+  RX_deliver = false;
   terminate_RX_Thread = true;
   SDRLOG(extHw_MSG_DEBUG, "Stopping ASYNC receive thread with rtlsdr_cancel_async() ..");
   rtlsdr_cancel_async(RtlSdrDev);
@@ -1469,8 +2078,21 @@ void RX_ThreadProc(void* p)
   else
   {
     SDRLG(extHw_MSG_WARNING, "RX_ThreadProc(): rtlsdr_read_async() finished unexpected - with %d", r);
-    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Stop);
+    const bool streaming = RX_deliver.load() && ThreadStreamToSDR.load();  // not at warm stop
+    reconnect_device = RtlOpenDevice;
+    reconnect_sample_count = rx_sample_count.load();
+    reconnect_lost_time = std::chrono::steady_clock::now();
     close_rtl_device();
+    if (streaming && (standby_active.load() || failover_to_standby("primary RX failure")))
+      ;   // the standby delivers - until StopHW()
+    else if (streaming && reconnect_timeout_s.load() && reconnect_device.dev_idx < MAX_RTL_DEVICES)
+    {
+      // host stays started: samples resume after the reconnect
+      if (Start_Reconnect_Thread() < 0)
+        EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Stop);
+    }
+    else if (RX_deliver.load())   // host is already stopped at warm stop
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Stop);
   }
 
   terminate_RX_Thread = true;
@@ -1480,6 +2102,60 @@ void RX_ThreadProc(void* p)
 }
 
 
+// USB arrival/removal notification: ConnCheck and DevEnum thread sleep until something happens.
+//   libusb's hotplug API isn't available on Windows - use the config manager.
+//   loaded dynamically: CM_Register_Notification() requires Windows 8.
+//   the registration's context is the event to set
+static HANDLE ConnCheck_event = NULL;   // auto-reset: USB device change or termination
+
+// GUID_DEVINTERFACE_USB_DEVICE
+static const GUID guid_usb_device = { 0xA5DCBF10, 0x6530, 0x11D2, { 0x90, 0x1F, 0x00, 0xC0, 0x4F, 0xB9, 0x51, 0xED } };
+
+typedef CONFIGRET(WINAPI* pfnCM_Register_Notification)(PCM_NOTIFY_FILTER, PVOID, PCM_NOTIFY_CALLBACK, PHCMNOTIFICATION);
+typedef CONFIGRET(WINAPI* pfnCM_Unregister_Notification)(HCMNOTIFICATION);
+
+static DWORD CALLBACK usb_device_notification(HCMNOTIFICATION h, PVOID ctx, CM_NOTIFY_ACTION action,
+  PCM_NOTIFY_EVENT_DATA data, DWORD data_size)
+{
+  if (action == CM_NOTIFY_ACTION_DEVICEINTERFACEARRIVAL || action == CM_NOTIFY_ACTION_DEVICEINTERFACEREMOVAL)
+    SetEvent((HANDLE)ctx);
+  return ERROR_SUCCESS;
+}
+
+// returns NULL, when not available: then poll
+static HCMNOTIFICATION register_usb_notification(HANDLE event)
+{
+  HMODULE cfgmgr = GetModuleHandleA("cfgmgr32.dll");
+  if (!cfgmgr)
+    cfgmgr = LoadLibraryA("cfgmgr32.dll");
+  if (!cfgmgr)
+    return NULL;
+  pfnCM_Register_Notification reg = (pfnCM_Register_Notification)GetProcAddress(cfgmgr, "CM_Register_Notification");
+  if (!reg)
+    return NULL;
+
+  CM_NOTIFY_FILTER filter;
+  memset(&filter, 0, sizeof(filter));
+  filter.cbSize = sizeof(filter);
+  filter.FilterType = CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE;
+  filter.u.DeviceInterface.ClassGuid = guid_usb_device;
+  HCMNOTIFICATION h = NULL;
+  if (reg(&filter, event, usb_device_notification, &h) != CR_SUCCESS)
+    return NULL;
+  return h;
+}
+
+static void unregister_usb_notification(HCMNOTIFICATION h)
+{
+  HMODULE cfgmgr = GetModuleHandleA("cfgmgr32.dll");
+  pfnCM_Unregister_Notification unreg = (cfgmgr)
+    ? (pfnCM_Unregister_Notification)GetProcAddress(cfgmgr, "CM_Unregister_Notification")
+    : nullptr;
+  if (h && unreg)
+    unreg(h);
+}
+
+
 int Start_ConnCheck_Thread()
 {
   //If already running, exit
@@ -1489,6 +2165,15 @@ int Start_ConnCheck_Thread()
     return 0;   // all fine
   }
 
+  if (!ConnCheck_event)
+    ConnCheck_event = CreateEvent(NULL, FALSE, FALSE, NULL);  // auto-reset
+  if (!ConnCheck_event)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_ConnCheck_Thread(): Error at CreateEvent()");
+    return -1;
+  }
+  ResetEvent(ConnCheck_event);
+
   terminate_ConnCheck_Thread = false;
 
   SDRLOG(extHw_MSG_DEBUG, "Starting ConnCheck thread ..");
@@ -1509,6 +2194,7 @@ int Stop_ConnCheck_Thread()
   SDRLOG(extHw_MSG_DEBUG, "Stopping ConnCheck thread  ..");
   if (ConnCheck_thread_handle == INVALID_HANDLE_VALUE)
     return 0;
+  SetEvent(ConnCheck_event);
   WaitForSingleObject(ConnCheck_thread_handle, INFINITE);
   SDRLOG(extHw_MSG_DEBUG, "Stop_ConnCheck_Thread(): thread() stopped successfully");
   ConnCheck_thread_handle = INVALID_HANDLE_VALUE;
@@ -1521,15 +2207,31 @@ void ConnCheck_ThreadProc(void* param)
   SDRLG(extHw_MSG_DEBUG, "ConnCheck_ThreadProc() with device handle 0x%p", RtlSdrDev);
   int counter = 0;
 
+  const HCMNOTIFICATION usb_notify = register_usb_notification(ConnCheck_event);
+  if (usb_notify)
+    SDRLOG(extHw_MSG_DEBUG, "ConnCheck_ThreadProc(): waiting for USB device notifications");
+  else
+    SDRLOG(extHw_MSG_DEBUG, "ConnCheck_ThreadProc(): no USB device notifications - polling");
+
   while (RtlSdrDev && !terminate_ConnCheck_Thread.load())
   {
-    Sleep(100);
-    if (terminate_ConnCheck_Thread.load())
-      break;
-    if (++counter <= 5)
-      continue;
+    if (usb_notify)
+    {
+      // no wakeups and no USB traffic, until some USB device comes or goes
+      WaitForSingleObject(ConnCheck_event, INFINITE);
+      if (terminate_ConnCheck_Thread.load())
+        break;
+    }
+    else
+    {
+      WaitForSingleObject(ConnCheck_event, 100);
+      if (terminate_ConnCheck_Thread.load())
+        break;
+      if (++counter <= 5)
+        continue;
+      counter = 0;
+    }
 
-    counter = 0;
     if (!is_device_handle_valid())
     {
       SDRLOG(extHw_MSG_ERROR, "ConnCheck_ThreadProc(): device handle got invalid!");
@@ -1537,8 +2239,218 @@ void ConnCheck_ThreadProc(void* param)
     }
   }
 
+  unregister_usb_notification(usb_notify);
   ConnCheck_thread_handle = INVALID_HANDLE_VALUE;
   SDRLOG(extHw_MSG_DEBUG, "ConnCheck_ThreadProc() finished. Finishing thread.");
   _endthread();
 }
 
+
+
+bool request_device_enumeration()
+{
+  if (!DevEnum_Thread_running.load())
+    return false;
+  SetEvent(DevEnum_event);
+  return true;
+}
+
+
+int Start_DevEnum_Thread()
+{
+  //If already running, exit
+  if (DevEnum_thread_handle != INVALID_HANDLE_VALUE)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_DevEnum_Thread(): Error thread still running!");
+    return 0;   // all fine
+  }
+
+  if (!DevEnum_event)
+    DevEnum_event = CreateEvent(NULL, FALSE, FALSE, NULL);  // auto-reset
+  if (!DevEnum_event)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_DevEnum_Thread(): Error at CreateEvent()");
+    return -1;
+  }
+  ResetEvent(DevEnum_event);
+
+  terminate_DevEnum_Thread = false;
+
+  SDRLOG(extHw_MSG_DEBUG, "Starting DevEnum thread ..");
+  DevEnum_thread_handle = (HANDLE)_beginthread(DevEnum_ThreadProc, 0, NULL);
+  if (DevEnum_thread_handle == INVALID_HANDLE_VALUE)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_DevEnum_Thread(): Error at _beginthread()");
+    return -1;  // ERROR
+  }
+  DevEnum_Thread_running = true;
+  return 0;
+}
+
+
+int Stop_DevEnum_Thread()
+{
+  // from now on, retrieve_devices() enumerates synchronous
+  DevEnum_Thread_running = false;
+  terminate_DevEnum_Thread = true;
+  SDRLOG(extHw_MSG_DEBUG, "Stopping DevEnum thread  ..");
+  if (DevEnum_thread_handle == INVALID_HANDLE_VALUE)
+    return 0;
+  SetEvent(DevEnum_event);
+  WaitForSingleObject(DevEnum_thread_handle, INFINITE);
+  SDRLOG(extHw_MSG_DEBUG, "Stop_DevEnum_Thread(): thread() stopped successfully");
+  DevEnum_thread_handle = INVALID_HANDLE_VALUE;
+  return 0;
+}
+
+void DevEnum_ThreadProc(void* param)
+{
+  SDRLOG(extHw_MSG_DEBUG, "DevEnum_ThreadProc() started");
+  // without notifications, the list is only refreshed on request
+  const HCMNOTIFICATION usb_notify = register_usb_notification(DevEnum_event);
+
+  while (!terminate_DevEnum_Thread.load())
+  {
+    WaitForSingleObject(DevEnum_event, INFINITE);
+    // an arriving device sends several notifications - and needs some time to be accessible
+    while (!terminate_DevEnum_Thread.load() && WaitForSingleObject(DevEnum_event, 300) == WAIT_OBJECT_0)
+      ;
+    if (terminate_DevEnum_Thread.load())
+      break;
+    enumerate_devices();
+  }
+
+  unregister_usb_notification(usb_notify);
+  DevEnum_thread_handle = INVALID_HANDLE_VALUE;
+  SDRLOG(extHw_MSG_DEBUG, "DevEnum_ThreadProc() finished. Finishing thread.");
+  _endthread();
+}
+
+
+int Start_Reconnect_Thread()
+{
+  //If already running, exit
+  if (Reconnect_thread_handle != INVALID_HANDLE_VALUE)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_Reconnect_Thread(): Error thread still running!");
+    return 0;   // all fine
+  }
+
+  if (!Reconnect_event)
+    Reconnect_event = CreateEvent(NULL, FALSE, FALSE, NULL);  // auto-reset
+  if (!Reconnect_event)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_Reconnect_Thread(): Error at CreateEvent()");
+    return -1;
+  }
+  ResetEvent(Reconnect_event);
+
+  terminate_Reconnect_Thread = false;
+
+  SDRLOG(extHw_MSG_DEBUG, "Starting Reconnect thread ..");
+  Reconnect_thread_handle = (HANDLE)_beginthread(Reconnect_ThreadProc, 0, NULL);
+  if (Reconnect_thread_handle == INVALID_HANDLE_VALUE)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_Reconnect_Thread(): Error at _beginthread()");
+    return -1;  // ERROR
+  }
+  return 0;
+}
+
+
+int Stop_Reconnect_Thread()
+{
+  terminate_Reconnect_Thread = true;
+  if (Reconnect_thread_handle == INVALID_HANDLE_VALUE)
+    return 0;
+  SDRLOG(extHw_MSG_DEBUG, "Stopping Reconnect thread  ..");
+  SetEvent(Reconnect_event);
+  WaitForSingleObject(Reconnect_thread_handle, INFINITE);
+  SDRLOG(extHw_MSG_DEBUG, "Stop_Reconnect_Thread(): thread() stopped successfully");
+  Reconnect_thread_handle = INVALID_HANDLE_VALUE;
+  return 0;
+}
+
+
+// recovery after a lost device, while the host keeps running:
+//   wait (backoff) -> find the same device -> reopen, which commands the complete state
+//   -> restart streaming. the gap shows up as a jump of the sample count
+void Reconnect_ThreadProc(void* param)
+{
+  char acMsg[256];
+  SDRLG(extHw_MSG_WARNING, "Reconnect_ThreadProc(): trying to reconnect '%s'", reconnect_device.name);
+
+  // a returning device wakes up the backoff wait
+  const HCMNOTIFICATION usb_notify = register_usb_notification(Reconnect_event);
+  DWORD backoff_ms = RECONNECT_MIN_BACKOFF_MS;
+  unsigned attempt = 0;
+  bool resumed = false;
+
+  while (!terminate_Reconnect_Thread.load() && ThreadStreamToSDR.load())
+  {
+    WaitForSingleObject(Reconnect_event, backoff_ms);
+    if (terminate_Reconnect_Thread.load() || !ThreadStreamToSDR.load())
+      break;
+
+    const auto lost_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - reconnect_lost_time).count();
+    const int timeout_s = reconnect_timeout_s.load();
+    if (!timeout_s || (timeout_s > 0 && lost_ms > 1000LL * timeout_s))
+    {
+      SDRLG(extHw_MSG_ERROR, "Reconnect_ThreadProc(): giving up after %u attempts in %lld ms", attempt, (long long)lost_ms);
+      break;
+    }
+    ++attempt;
+    backoff_ms = (2 * backoff_ms < RECONNECT_MAX_BACKOFF_MS) ? (2 * backoff_ms) : RECONNECT_MAX_BACKOFF_MS;
+
+    // search: the same vendor, product and serial - at any USB index
+    enumerate_devices();
+    const uint32_t N = retrieve_devices();
+    uint32_t k = 0;
+    while (k < N && !(RtlDeviceList[k].dev_idx < MAX_RTL_DEVICES && RtlDeviceInfo::is_same(RtlDeviceList[k], reconnect_device)))
+      ++k;
+    if (k >= N)
+    {
+      SDRLG(extHw_MSG_DEBUG, "Reconnect_ThreadProc(): attempt %u: device not found. next in %u ms", attempt, unsigned(backoff_ms));
+      continue;
+    }
+
+    // open: replays the complete requested state to the fresh device
+    RtlSelectedDeviceIdx = k;
+    if (!open_selected_rtl_device())
+    {
+      SDRLG(extHw_MSG_WARNING, "Reconnect_ThreadProc(): attempt %u: open failed. next in %u ms", attempt, unsigned(backoff_ms));
+      continue;
+    }
+
+    // continue the sample count, as if the device had been streaming all the time.
+    //   set before the RX thread runs: it owns the counter then
+    const auto gap_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - reconnect_lost_time).count();
+    const int srate_idx = last.srate_idx.load();
+    const int64_t srate = (srate_idx >= 0 && srate_idx < int(rates::N)) ? rates::tab[srate_idx].valueInt : 0;
+    const int64_t lost = gap_us * srate / 1000000;
+    if (Start_RX_Thread(reconnect_sample_count + lost) < 0)
+    {
+      SDRLG(extHw_MSG_WARNING, "Reconnect_ThreadProc(): attempt %u: streaming failed. next in %u ms", attempt, unsigned(backoff_ms));
+      close_rtl_device();
+      continue;
+    }
+    SDRLG(extHw_MSG_WARNING, "Reconnect_ThreadProc(): resumed after %lld ms with %u attempts: discontinuity of %lld samples at sample %lld",
+      (long long)(gap_us / 1000), attempt, (long long)lost, (long long)reconnect_sample_count);
+    post_update_gui_init();
+    resumed = true;
+    break;
+  }
+
+  unregister_usb_notification(usb_notify);
+  // before the host callback: StopHW() from there must not wait for this thread
+  Reconnect_thread_handle = INVALID_HANDLE_VALUE;
+  if (!resumed && !terminate_Reconnect_Thread.load() && ThreadStreamToSDR.load())
+  {
+    // as without reconnect: the operator has to restart
+    EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Stop);
+  }
+  SDRLOG(extHw_MSG_DEBUG, "Reconnect_ThreadProc() finished. Finishing thread.");
+  _endthread();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+// C API of ExtIO_RTL.dll for applications streaming several dongles in parallel -
+//   besides the ExtIO interface for the host's device. each RtlCtxHandle is an RtlDevCtx:
+//   own device, control and RX thread. a dongle opened by the host can't be opened here.
+// samples are passed raw (u8 I/Q) to the callback - in the handle's RX thread.
+//   or aligned across the handles, as float I/Q, by a CoherentHandle.
+
+#include "LC_ExtIO_Types.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct RtlCtxApi* RtlCtxHandle;
+
+// RX thread: n_iq_pairs received u8 I/Q pairs. first_idx: index of the first pair since start
+typedef void (EXTIO_CALL * pfnRtlCtxSamples)(RtlCtxHandle h, const uint8_t* iq, uint32_t n_iq_pairs, int64_t first_idx, void* user);
+
+#define RTL_CTX_GAIN_AUTO   (-1000)
+
+// NULL on error
+RtlCtxHandle EXTIO_CALL RtlCtxOpen(uint32_t dev_idx);
+RtlCtxHandle EXTIO_CALL RtlCtxOpenSerial(const char* serial);
+void EXTIO_CALL RtlCtxClose(RtlCtxHandle h);   // stops streaming
+
+// buf_len: bytes per USB transfer. returns 0 - or -1 on error
+int EXTIO_CALL RtlCtxStart(RtlCtxHandle h, pfnRtlCtxSamples cb, void* user, uint32_t buf_len);
+void EXTIO_CALL RtlCtxStop(RtlCtxHandle h);
+
+// applied asynchronously by the handle's control thread
+void EXTIO_CALL RtlCtxSetFreq(RtlCtxHandle h, int64_t freq);
+void EXTIO_CALL RtlCtxSetSrate(RtlCtxHandle h, int srate);
+void EXTIO_CALL RtlCtxSetGain(RtlCtxHandle h, int tenth_db);   // RTL_CTX_GAIN_AUTO == tuner AGC
+void EXTIO_CALL RtlCtxSetPpm(RtlCtxHandle h, int ppm);
+void EXTIO_CALL RtlCtxSetBiasTee(RtlCtxHandle h, int on);
+
+const char* EXTIO_CALL RtlCtxGetSerial(RtlCtxHandle h);
+int64_t EXTIO_CALL RtlCtxGetSampleCount(RtlCtxHandle h);
+
+
+// coherent capture: sample aligned blocks of several handles - see CoherentAligner in coherent.h.
+//   the aligner streams the handles itself: they must not be started with RtlCtxStart()
+
+typedef struct CoherentApi* CoherentHandle;
+
+// delivery thread: iq[k] are n_pairs interleaved float I/Q of device k.
+//   ref_idx: index of the first pair in the stream of device 0.
+//   realigned != 0: offsets changed or samples were lost before this block
+typedef void (EXTIO_CALL * pfnCoherentBlock)(CoherentHandle h, const float* const* iq, unsigned n_dev, uint32_t n_pairs, int64_t ref_idx, int realigned, void* user);
+// switches the reference source on (1) / off (0)
+typedef void (EXTIO_CALL * pfnCoherentInject)(CoherentHandle h, int on, void* user);
+
+// corr_len: FFT length (power of 2). ring_len: I/Q pairs per device (power of 2). NULL on error
+CoherentHandle EXTIO_CALL CoherentCreate(unsigned n_dev, uint32_t block_len, unsigned corr_len, uint32_t ring_len, unsigned n_workers);
+void EXTIO_CALL CoherentDestroy(CoherentHandle h);   // stops streaming. the handles stay open
+
+// before CoherentStart()
+void EXTIO_CALL CoherentSetCallback(CoherentHandle h, pfnCoherentBlock cb, void* user);
+void EXTIO_CALL CoherentSetInjector(CoherentHandle h, pfnCoherentInject fn, void* user);
+
+void EXTIO_CALL CoherentSetBurstDetect(CoherentHandle h, int on, float threshold_db);
+void EXTIO_CALL CoherentSetMinCorrelation(CoherentHandle h, float rho);
+
+// devs[0] is the reference. returns 0 - or -1 on error
+int EXTIO_CALL CoherentStart(CoherentHandle h, const RtlCtxHandle* devs, uint32_t usb_buf_len);
+void EXTIO_CALL CoherentStop(CoherentHandle h);
+
+void EXTIO_CALL CoherentCalibrate(CoherentHandle h);
+void EXTIO_CALL CoherentInjectBurst(CoherentHandle h);
+
+int EXTIO_CALL CoherentIsAligned(CoherentHandle h);
+unsigned EXTIO_CALL CoherentGetGeneration(CoherentHandle h);   // incremented at each new set of offsets
+// offset of device k: its sample (idx + samples) was received together with sample idx of device 0
+int EXTIO_CALL CoherentGetOffset(CoherentHandle h, unsigned k, int64_t* samples, float* frac, float* phase, float* corr);
+uint64_t EXTIO_CALL CoherentGetOverruns(CoherentHandle h);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,754 @@
+
+#include "coherent.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <windows.h>
+#include <process.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <cmath>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+#define SDRLG( A, TEXT, ...) do { if ( gpfnExtIOCallbackPtr ) { snprintf(acMsg, 255, TEXT, __VA_ARGS__); gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); } } while (0)
+
+
+static const double PI = 3.14159265358979323846;
+static constexpr int64_t INJECT_TIMEOUT_NS = 1000000000;   // no burst within 1 s: give up
+
+static int64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+CoherentAligner::CoherentAligner()
+  : n_dev(0)
+  , block_len(0)
+  , ring_len(0)
+  , n_workers(0)
+  , srate(0.0)
+  , workers(nullptr)
+  , callback(nullptr)
+  , callback_user(nullptr)
+  , inject_fn(nullptr)
+  , inject_user(nullptr)
+  , delivery_thread(INVALID_HANDLE_VALUE)
+  , data_event(NULL)
+  , det_buf(nullptr)
+  , out_pos(0)
+  , out_generation(0)
+  , out_realigned(true)
+  , det_pos(0)
+  , det_avg(0.0)
+  , det_chunks(0)
+  , det_in_burst(false)
+  , pending_i0(-1)
+  , inject_deadline_ns(0)
+  , job_sema(NULL)
+  , n_jobs(0)
+  , jobs_outstanding(0)
+  , terminate(false)
+  , aligned(false)
+  , cal_generation(0)
+  , cal_request(false)
+  , cal_busy(false)
+  , detect_on(false)
+  , detect_armed(false)
+  , injecting(false)
+  , detect_ratio(10.0F)
+  , min_corr(0.3F)
+  , overruns(0)
+{
+  for (unsigned k = 0; k < MAX_DEVICES; ++k)
+    out[k] = nullptr;
+}
+
+CoherentAligner::~CoherentAligner()
+{
+  release();
+}
+
+
+void CoherentAligner::release()
+{
+  stop();
+  for (unsigned k = 0; k < MAX_DEVICES; ++k)
+  {
+    free_aligned_floats(slots[k].ring);
+    slots[k].ring = nullptr;
+    free_aligned_floats(out[k]);
+    out[k] = nullptr;
+  }
+  for (unsigned w = 0; workers && w < n_workers; ++w)
+  {
+    free_aligned_floats(workers[w].a_re);
+    free_aligned_floats(workers[w].a_im);
+    free_aligned_floats(workers[w].b_re);
+    free_aligned_floats(workers[w].b_im);
+    delete[] workers[w].b_energy;
+  }
+  delete[] workers;
+  workers = nullptr;
+  free_aligned_floats(det_buf);
+  det_buf = nullptr;
+  if (data_event)
+    CloseHandle(data_event);
+  if (job_sema)
+    CloseHandle(job_sema);
+  data_event = job_sema = NULL;
+  fft.release();
+  n_dev = n_workers = 0;
+}
+
+
+bool CoherentAligner::init(unsigned n, uint32_t blk_len, unsigned corr_len, uint32_t rng_len, unsigned n_work)
+{
+  release();
+  if (n < 2 || n > MAX_DEVICES || !blk_len || !n_work)
+    return false;
+  if ((rng_len & (rng_len - 1)) || rng_len < 2 * corr_len || rng_len < 4 * blk_len)
+    return false;
+  if (!fft.init(corr_len))
+    return false;
+
+  n_dev = n;
+  block_len = blk_len;
+  ring_len = rng_len;
+  n_workers = n_work;
+
+  bool ok = true;
+  for (unsigned k = 0; k < n_dev; ++k)
+  {
+    slots[k].owner = this;
+    slots[k].ring = alloc_aligned_floats(2 * size_t(ring_len));
+    out[k] = alloc_aligned_floats(2 * size_t(block_len));
+    ok = ok && slots[k].ring && out[k];
+  }
+  workers = new Worker[n_workers];
+  for (unsigned w = 0; w < n_workers; ++w)
+  {
+    Worker& wk = workers[w];
+    wk.owner = this;
+    wk.thread = INVALID_HANDLE_VALUE;
+    wk.a_re = alloc_aligned_floats(corr_len);
+    wk.a_im = alloc_aligned_floats(corr_len);
+    wk.b_re = alloc_aligned_floats(corr_len);
+    wk.b_im = alloc_aligned_floats(corr_len);
+    wk.b_energy = new double[corr_len / 2 + 1];
+    ok = ok && wk.a_re && wk.a_im && wk.b_re && wk.b_im;
+  }
+  det_buf = alloc_aligned_floats(2 * size_t(corr_len / 8));
+  data_event = CreateEvent(NULL, FALSE, FALSE, NULL);  // auto-reset
+  job_sema = CreateSemaphore(NULL, 0, LONG(MAX_DEVICES + n_workers), NULL);
+  ok = ok && det_buf && data_event && job_sema;
+  if (!ok)
+  {
+    release();
+    return false;
+  }
+  return true;
+}
+
+
+void CoherentAligner::set_callback(BlockCallback cb, void* user)
+{
+  callback = cb;
+  callback_user = user;
+}
+
+void CoherentAligner::set_injector(InjectFn fn, void* user)
+{
+  inject_fn = fn;
+  inject_user = user;
+}
+
+void CoherentAligner::set_burst_detect(bool on, float threshold_db)
+{
+  detect_ratio = float(std::pow(10.0, threshold_db / 10.0));
+  detect_on = on;
+}
+
+void CoherentAligner::set_min_correlation(float rho)
+{
+  min_corr = rho;
+}
+
+void CoherentAligner::calibrate()
+{
+  cal_request = true;
+  if (data_event)
+    SetEvent(data_event);
+}
+
+void CoherentAligner::inject_burst()
+{
+  if (!inject_fn)
+  {
+    calibrate();
+    return;
+  }
+  if (injecting.exchange(true))
+    return;   // already running
+  inject_deadline_ns = 0;   // set by the delivery thread
+  detect_armed = true;
+  inject_fn(true, inject_user);
+}
+
+void CoherentAligner::end_injection()
+{
+  detect_armed = false;
+  if (injecting.exchange(false) && inject_fn)
+    inject_fn(false, inject_user);
+}
+
+
+CoherentAligner::Offset CoherentAligner::get_offset(unsigned k) const
+{
+  Offset o = { 0, 0.0F, 0.0F, 1.0F };
+  if (k >= n_dev || !k)
+    return o;
+  const Slot& s = slots[k];
+  o.samples = s.off.load();
+  o.frac = s.frac.load();
+  o.phase = s.phase.load();
+  o.corr = s.corr.load();
+  return o;
+}
+
+
+int CoherentAligner::start(RtlDevCtx* const* devs, uint32_t usb_buf_len)
+{
+  char acMsg[256];
+  if (!n_dev || !callback)
+    return -1;
+  if (delivery_thread != INVALID_HANDLE_VALUE)
+    return 0;   // all fine
+
+  srate = double(devs[0]->get_srate());
+  for (unsigned k = 0; k < n_dev; ++k)
+  {
+    Slot& s = slots[k];
+    s.dev = devs[k];
+    s.wr = s.claim = 0;
+    s.resync = false;
+    s.stamp_seq = 0;
+    s.stamp_idx = s.stamp_ns = 0;
+    s.off = 0;
+  }
+  aligned = false;
+  out_pos = 0;
+  out_generation = cal_generation.load();
+  out_realigned = true;
+  det_pos = 0;
+  det_avg = 0.0;
+  det_chunks = 0;
+  det_in_burst = false;
+  pending_i0 = -1;
+  n_jobs = jobs_outstanding = 0;
+  cal_busy = false;
+  terminate = false;
+
+  for (unsigned w = 0; w < n_workers; ++w)
+  {
+    workers[w].thread = (void*)_beginthread(worker_thread_proc, 0, &workers[w]);
+    if (workers[w].thread == INVALID_HANDLE_VALUE)
+    {
+      SDRLOG(extHw_MSG_ERROR, "CoherentAligner::start(): error starting worker thread");
+      stop();
+      return -1;
+    }
+  }
+  delivery_thread = (void*)_beginthread(delivery_thread_proc, 0, this);
+  if (delivery_thread == INVALID_HANDLE_VALUE)
+  {
+    SDRLOG(extHw_MSG_ERROR, "CoherentAligner::start(): error starting delivery thread");
+    stop();
+    return -1;
+  }
+
+  for (unsigned k = 0; k < n_dev; ++k)
+  {
+    if (devs[k]->start(rx_callback, &slots[k], usb_buf_len) < 0)
+    {
+      SDRLG(extHw_MSG_ERROR, "CoherentAligner::start(): error starting device %u", k);
+      stop();
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+void CoherentAligner::stop()
+{
+  for (unsigned k = 0; k < n_dev; ++k)
+  {
+    if (slots[k].dev)
+      slots[k].dev->stop();
+  }
+
+  terminate = true;
+  if (data_event)
+    SetEvent(data_event);
+  if (delivery_thread != INVALID_HANDLE_VALUE)
+    WaitForSingleObject((HANDLE)delivery_thread, INFINITE);
+  delivery_thread = INVALID_HANDLE_VALUE;
+
+  if (job_sema && workers)
+    ReleaseSemaphore(job_sema, LONG(n_workers), NULL);
+  for (unsigned w = 0; workers && w < n_workers; ++w)
+  {
+    if (workers[w].thread != INVALID_HANDLE_VALUE)
+      WaitForSingleObject((HANDLE)workers[w].thread, INFINITE);
+    workers[w].thread = INVALID_HANDLE_VALUE;
+  }
+  end_injection();
+  cal_busy = false;
+}
+
+
+// RX thread of device k: convert and store. no waiting
+void CoherentAligner::rx_callback(RtlDevCtx& ctx, const uint8_t* iq, uint32_t n_iq_pairs, int64_t first_idx, void* user)
+{
+  Slot& s = *(Slot*)user;
+  s.owner->push(s, iq, n_iq_pairs, first_idx);
+}
+
+void CoherentAligner::push(Slot& s, const uint8_t* iq, uint32_t n, int64_t first_idx)
+{
+  int64_t wr = s.wr.load(std::memory_order_relaxed);
+  if (first_idx != wr)
+  {
+    s.resync = true;  // gap in the stream: offsets are no longer known
+    wr = first_idx;
+  }
+
+  // readers check the claim after copying: overwritten samples are detected
+  s.claim.store(wr + n, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const uint32_t mask = ring_len - 1;
+  for (uint32_t i = 0; i < n; ++i)
+  {
+    float* d = s.ring + 2 * ((wr + i) & mask);
+    d[0] = (float(iq[2 * i]) - 127.5F) * (1.0F / 127.5F);
+    d[1] = (float(iq[2 * i + 1]) - 127.5F) * (1.0F / 127.5F);
+  }
+  s.wr.store(wr + n, std::memory_order_release);
+
+  const uint32_t seq = s.stamp_seq.load(std::memory_order_relaxed);
+  s.stamp_seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  s.stamp_idx.store(wr + n, std::memory_order_relaxed);
+  s.stamp_ns.store(now_ns(), std::memory_order_relaxed);
+  s.stamp_seq.store(seq + 2, std::memory_order_release);
+
+  SetEvent(data_event);
+}
+
+
+int CoherentAligner::read_iq(const Slot& s, int64_t idx, uint32_t n, float* dst) const
+{
+  const int64_t wr = s.wr.load(std::memory_order_acquire);
+  if (idx < 0 || idx < wr - int64_t(ring_len))
+    return -1;
+  if (idx + n > wr)
+    return 0;
+  const uint32_t mask = ring_len - 1;
+  const uint32_t p = uint32_t(idx & mask);
+  const uint32_t n1 = (p + n <= ring_len) ? n : (ring_len - p);
+  memcpy(dst, s.ring + 2 * size_t(p), 2 * sizeof(float) * n1);
+  if (n1 < n)
+    memcpy(dst + 2 * size_t(n1), s.ring, 2 * sizeof(float) * (n - n1));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return (idx >= s.claim.load(std::memory_order_relaxed) - int64_t(ring_len)) ? 1 : -1;
+}
+
+int CoherentAligner::read_split(const Slot& s, int64_t idx, uint32_t n, float* re, float* im) const
+{
+  const int64_t wr = s.wr.load(std::memory_order_acquire);
+  if (idx < 0 || idx < wr - int64_t(ring_len))
+    return -1;
+  if (idx + n > wr)
+    return 0;
+  const uint32_t mask = ring_len - 1;
+  for (uint32_t i = 0; i < n; ++i)
+  {
+    const float* p = s.ring + 2 * ((idx + i) & mask);
+    re[i] = p[0];
+    im[i] = p[1];
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return (idx >= s.claim.load(std::memory_order_relaxed) - int64_t(ring_len)) ? 1 : -1;
+}
+
+
+// offset estimate from the arrival times of the last USB buffers.
+//   accuracy is the USB scheduling jitter: correlate() has to cover it
+int64_t CoherentAligner::coarse_offset(unsigned k) const
+{
+  int64_t idx[2], ns[2];
+  const unsigned dev[2] = { 0, k };
+  for (int d = 0; d < 2; ++d)
+  {
+    const Slot& s = slots[dev[d]];
+    uint32_t seq;
+    do
+    {
+      seq = s.stamp_seq.load(std::memory_order_acquire);
+      idx[d] = s.stamp_idx.load(std::memory_order_relaxed);
+      ns[d] = s.stamp_ns.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != s.stamp_seq.load(std::memory_order_relaxed));
+  }
+  // index of both devices at the same time
+  return idx[1] - idx[0] + std::llround(double(ns[0] - ns[1]) * srate * 1E-9);
+}
+
+
+bool CoherentAligner::schedule_calibration(int64_t i0)
+{
+  if (i0 < 0 || cal_busy.load() || pending_i0 >= 0)
+    return false;
+  for (unsigned k = 0; k < n_dev; ++k)
+  {
+    if (!slots[k].wr.load())
+      return false;   // no arrival time yet
+  }
+  const bool have_offsets = aligned.load();
+  for (unsigned k = 1; k < n_dev; ++k)
+    pending_guess[k] = (have_offsets) ? slots[k].off.load() : coarse_offset(k);
+  pending_i0 = i0;
+  return true;
+}
+
+
+// delivery thread: start the jobs, when all devices received the correlation windows
+bool CoherentAligner::dispatch_calibration()
+{
+  char acMsg[256];
+  if (pending_i0 < 0)
+    return false;
+  const int64_t N = fft.length();
+  for (unsigned k = 0; k < n_dev; ++k)
+  {
+    const int64_t wr = slots[k].wr.load();
+    const int64_t beg = (k) ? (pending_i0 + pending_guess[k] - N / 8) : pending_i0;
+    const int64_t end = beg + ((k) ? N / 2 : N / 4);
+    if (beg < 0 || beg < wr - int64_t(ring_len))
+    {
+      SDRLG(extHw_MSG_WARNING, "CoherentAligner: correlation window of device %u not available", k);
+      pending_i0 = -1;
+      end_injection();
+      return false;
+    }
+    if (end > wr)
+      return false;   // wait
+  }
+
+  cal_busy = true;
+  {
+    std::lock_guard<std::mutex> lock(job_mutex);
+    n_jobs = jobs_outstanding = n_dev - 1;
+    for (unsigned k = 1; k < n_dev; ++k)
+    {
+      jobs[k - 1].dev = k;
+      jobs[k - 1].i0 = pending_i0;
+      jobs[k - 1].guess = pending_guess[k];
+    }
+  }
+  pending_i0 = -1;
+  ReleaseSemaphore(job_sema, LONG(n_dev - 1), NULL);
+  return true;
+}
+
+
+// delivery thread: power detector on device 0 - a burst starts a calibration at its edge
+void CoherentAligner::detect_bursts()
+{
+  const uint32_t chunk = fft.length() / 8;
+  const Slot& s = slots[0];
+  const int64_t wr = s.wr.load();
+  if (det_pos < wr - int64_t(ring_len) + chunk)
+    det_pos = wr - (wr % chunk);   // fell behind: restart at the newest chunk
+
+  while (det_pos + chunk <= wr)
+  {
+    if (read_iq(s, det_pos, chunk, det_buf) <= 0)
+    {
+      det_pos = s.wr.load();
+      det_pos -= det_pos % chunk;
+      return;
+    }
+    double p = 0.0;
+    for (uint32_t i = 0; i < 2 * chunk; ++i)
+      p += double(det_buf[i]) * det_buf[i];
+    p /= chunk;
+
+    const bool active = detect_on.load() || detect_armed.load();
+    if (det_chunks >= 8 && p > detect_ratio.load() * det_avg)
+    {
+      // rising edge: the a-window starts one chunk before
+      if (!det_in_burst && active && schedule_calibration(det_pos - chunk))
+        detect_armed = false;
+      det_in_burst = true;
+    }
+    else
+    {
+      det_avg = (det_chunks) ? (0.9 * det_avg + 0.1 * p) : p;
+      ++det_chunks;
+      det_in_burst = false;
+    }
+    det_pos += chunk;
+  }
+}
+
+
+// delivery thread: cut aligned blocks
+void CoherentAligner::deliver_blocks()
+{
+  const unsigned gen = cal_generation.load(std::memory_order_acquire);
+  if (gen != out_generation)
+  {
+    out_generation = gen;
+    out_pos = -1;
+  }
+  int64_t off[MAX_DEVICES];
+  off[0] = 0;
+  for (unsigned k = 1; k < n_dev; ++k)
+    off[k] = slots[k].off.load();
+
+  while (!terminate.load())
+  {
+    if (out_pos < 0)
+    {
+      // (re)start at the newest sample, which all devices have received
+      int64_t t = INT64_MAX, t_min = 0;
+      for (unsigned k = 0; k < n_dev; ++k)
+      {
+        const int64_t wr = slots[k].wr.load();
+        t = (wr - off[k] < t) ? (wr - off[k]) : t;
+        t_min = (-off[k] > t_min) ? -off[k] : t_min;
+      }
+      out_pos = (t > t_min) ? t : t_min;
+      out_realigned = true;
+    }
+
+    int r = 1;
+    for (unsigned k = 0; k < n_dev && r > 0; ++k)
+      r = read_iq(slots[k], out_pos + off[k], block_len, out[k]);
+    if (r == 0)
+      return;   // wait for more
+    if (r < 0)
+    {
+      ++overruns;
+      out_pos = -1;
+      continue;
+    }
+    callback(out, n_dev, block_len, out_pos, out_realigned, callback_user);
+    out_realigned = false;
+    out_pos += block_len;
+  }
+}
+
+
+void CoherentAligner::delivery_thread_proc(void* param)
+{
+  CoherentAligner& c = *(CoherentAligner*)param;
+  const int64_t N = c.fft.length();
+
+  while (!c.terminate.load())
+  {
+    WaitForSingleObject(c.data_event, 100);
+    if (c.terminate.load())
+      break;
+
+    bool resync = false;
+    for (unsigned k = 0; k < c.n_dev; ++k)
+      resync = c.slots[k].resync.exchange(false) || resync;
+    if (resync && c.aligned.exchange(false))
+    {
+      SDRLOG(extHw_MSG_WARNING, "CoherentAligner: gap in a stream - recalibrating");
+      c.cal_request = true;
+    }
+
+    if (c.injecting.load())
+    {
+      if (!c.inject_deadline_ns)
+        c.inject_deadline_ns = now_ns() + INJECT_TIMEOUT_NS;
+      else if (c.detect_armed.load() && now_ns() > c.inject_deadline_ns)
+      {
+        SDRLOG(extHw_MSG_WARNING, "CoherentAligner: no reference burst detected");
+        c.end_injection();
+      }
+    }
+
+    if (c.cal_request.load() && !c.cal_busy.load() && c.pending_i0 < 0)
+    {
+      const int64_t i0 = c.slots[0].wr.load() - N / 4;
+      if (c.schedule_calibration(i0))
+        c.cal_request = false;
+    }
+    c.detect_bursts();
+    c.dispatch_calibration();
+
+    if (c.aligned.load())
+      c.deliver_blocks();
+  }
+
+  c.delivery_thread = INVALID_HANDLE_VALUE;
+  _endthread();
+}
+
+
+void CoherentAligner::worker_thread_proc(void* param)
+{
+  Worker& w = *(Worker*)param;
+  CoherentAligner& c = *w.owner;
+  while (true)
+  {
+    WaitForSingleObject(c.job_sema, INFINITE);
+    if (c.terminate.load())
+      break;
+    Job j;
+    {
+      std::lock_guard<std::mutex> lock(c.job_mutex);
+      if (!c.n_jobs)
+        continue;
+      j = c.jobs[--c.n_jobs];
+    }
+    c.correlate(w, j);
+    c.finish_job();
+  }
+  w.thread = INVALID_HANDLE_VALUE;
+  _endthread();
+}
+
+
+// worker thread: cross-correlation of device 0 (a: N/4 samples) with device k (b: N/2 samples
+//   around the expected position). both zero padded to N: c[m] = sum a*[n] b[n+m] is not
+//   wrapped for m = 0 .. N/4 - covering the guess +- N/8.
+void CoherentAligner::correlate(Worker& w, const Job& j)
+{
+  const unsigned N = fft.length();
+  const unsigned na = N / 4, nb = N / 2;
+  Slot& sk = slots[j.dev];
+  sk.cal_ok = false;
+
+  const int64_t ib = j.i0 + j.guess - N / 8;
+  if (read_split(slots[0], j.i0, na, w.a_re, w.a_im) <= 0 || read_split(sk, ib, nb, w.b_re, w.b_im) <= 0)
+    return;
+  for (unsigned i = na; i < N; ++i)
+    w.a_re[i] = w.a_im[i] = 0.0F;
+  for (unsigned i = nb; i < N; ++i)
+    w.b_re[i] = w.b_im[i] = 0.0F;
+
+  double ea = 0.0;
+  for (unsigned i = 0; i < na; ++i)
+    ea += double(w.a_re[i]) * w.a_re[i] + double(w.a_im[i]) * w.a_im[i];
+  w.b_energy[0] = 0.0;
+  for (unsigned i = 0; i < nb; ++i)
+    w.b_energy[i + 1] = w.b_energy[i] + double(w.b_re[i]) * w.b_re[i] + double(w.b_im[i]) * w.b_im[i];
+
+  fft.forward(w.a_re, w.a_im);
+  fft.forward(w.b_re, w.b_im);
+  // conj(A) * B
+  for (unsigned i = 0; i < N; ++i)
+  {
+    const float re = w.a_re[i] * w.b_re[i] + w.a_im[i] * w.b_im[i];
+    const float im = w.a_re[i] * w.b_im[i] - w.a_im[i] * w.b_re[i];
+    w.a_re[i] = re;
+    w.a_im[i] = im;
+  }
+  fft.inverse(w.a_re, w.a_im);
+
+  unsigned m0 = 0;
+  float p0 = -1.0F;
+  for (unsigned m = 0; m <= na; ++m)
+  {
+    const float p = w.a_re[m] * w.a_re[m] + w.a_im[m] * w.a_im[m];
+    if (p > p0)
+    {
+      p0 = p;
+      m0 = m;
+    }
+  }
+
+  // fractional peak position: parabola through the magnitudes
+  float frac = 0.0F;
+  if (m0 > 0 && m0 < na)
+  {
+    const float ym = std::sqrt(w.a_re[m0 - 1] * w.a_re[m0 - 1] + w.a_im[m0 - 1] * w.a_im[m0 - 1]);
+    const float y0 = std::sqrt(p0);
+    const float yp = std::sqrt(w.a_re[m0 + 1] * w.a_re[m0 + 1] + w.a_im[m0 + 1] * w.a_im[m0 + 1]);
+    const float den = ym - 2.0F * y0 + yp;
+    if (den < 0.0F)
+      frac = 0.5F * (ym - yp) / den;
+  }
+
+  // the inverse transform is not scaled
+  const double eb = w.b_energy[m0 + na] - w.b_energy[m0];
+  const double rho = (ea > 0.0 && eb > 0.0) ? std::sqrt(double(p0)) / N / std::sqrt(ea * eb) : 0.0;
+
+  sk.cal_off = ib + m0 - j.i0;
+  sk.cal_frac = frac;
+  sk.cal_phase = float(std::atan2(w.a_im[m0], w.a_re[m0]));
+  sk.cal_corr = float(rho);
+  sk.cal_ok = (rho >= min_corr.load());
+}
+
+
+// worker thread: the last job of a round publishes the new offsets
+void CoherentAligner::finish_job()
+{
+  char acMsg[256];
+  {
+    std::lock_guard<std::mutex> lock(job_mutex);
+    if (--jobs_outstanding)
+      return;
+  }
+
+  bool ok = true;
+  for (unsigned k = 1; k < n_dev; ++k)
+    ok = ok && slots[k].cal_ok;
+  if (ok)
+  {
+    for (unsigned k = 1; k < n_dev; ++k)
+    {
+      Slot& s = slots[k];
+      s.off = s.cal_off;
+      s.frac = s.cal_frac;
+      s.phase = s.cal_phase;
+      s.corr = s.cal_corr;
+      SDRLG(extHw_MSG_DEBUG, "CoherentAligner: device %u offset %lld%+.2f samples, phase %.1f deg, corr %.2f",
+        k, (long long)s.cal_off, s.cal_frac, s.cal_phase * 180.0 / PI, s.cal_corr);
+    }
+    cal_generation.fetch_add(1, std::memory_order_release);
+    aligned = true;
+  }
+  else
+  {
+    for (unsigned k = 1; k < n_dev; ++k)
+    {
+      if (!slots[k].cal_ok)
+        SDRLG(extHw_MSG_WARNING, "CoherentAligner: calibration of device %u failed (corr %.2f)", k, slots[k].cal_corr);
+    }
+  }
+  end_injection();
+  cal_busy = false;
+  SetEvent(data_event);
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "fft.h"
+#include "rtl_dev_ctx.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+// sample alignment of several RtlDevCtx streams for coherent capture - e.g. direction finding
+//   with dongles sharing one clock.
+//
+// each dongle starts streaming at its own time: the offsets between the sample indices are
+//   estimated by FFT cross-correlation of a common reference. that is an injected burst
+//   (set_injector() + inject_burst()), a detected burst (set_burst_detect()) or any strong
+//   signal all devices receive (calibrate()).
+// offset of device k: its sample (idx + offset) was received together with sample idx of device 0.
+//   the integer part aligns the delivered blocks. fractional part and phase are only reported.
+//
+// exported as C API: Coherent*() in ExtIO_RTL_multi.h.
+//
+// threading: the RX threads only convert into per device ring buffers - they never wait.
+//   a delivery thread cuts the aligned blocks, calls the combined callback and runs the burst
+//   detector. the correlations run on a pool of worker threads.
+
+struct CoherentAligner
+{
+  static constexpr unsigned MAX_DEVICES = 8;
+
+  // delivery thread: iq[k] are n_pairs interleaved float I/Q of device k.
+  //   ref_idx: index of the first pair in the stream of device 0.
+  //   realigned: offsets changed or samples were lost before this block
+  typedef void (*BlockCallback)(const float* const* iq, unsigned n_dev, uint32_t n_pairs, int64_t ref_idx, bool realigned, void* user);
+  // switches the reference source on/off. called from any of the threads
+  typedef void (*InjectFn)(bool on, void* user);
+
+  struct Offset
+  {
+    int64_t samples;  // integer offset
+    float frac;       // fractional part: -0.5 .. +0.5 samples
+    float phase;      // radians: phase of device k minus phase of device 0
+    float corr;       // normalized correlation at the peak: 0 .. 1
+  };
+
+  CoherentAligner();
+  ~CoherentAligner();
+
+  // allocates! corr_len: FFT length (power of 2) - corrects offset errors up to +-corr_len/8.
+  //   ring_len: I/Q pairs per device ring (power of 2) - must hold the correlation windows
+  bool init(unsigned n_dev, uint32_t block_len, unsigned corr_len, uint32_t ring_len, unsigned n_workers);
+  void release();
+
+  // before start()
+  void set_callback(BlockCallback cb, void* user);
+  void set_injector(InjectFn fn, void* user);
+
+  void set_burst_detect(bool on, float threshold_db = 10.0F);
+  void set_min_correlation(float rho);
+
+  // starts streaming of all n_dev devices with this aligner's RX callback. devs[0] is the reference
+  int start(RtlDevCtx* const* devs, uint32_t usb_buf_len);
+  void stop();    // stops the devices, then the threads
+
+  void calibrate();     // correlate the newest common window
+  void inject_burst();  // reference on, detect the burst, correlate, reference off
+
+  unsigned num_devices() const { return n_dev; }
+  bool is_aligned() const { return aligned.load(); }
+  unsigned generation() const { return cal_generation.load(); }   // incremented at each new set of offsets
+  Offset get_offset(unsigned k) const;
+  uint64_t get_overruns() const { return overruns.load(); }
+
+private:
+  CoherentAligner(const CoherentAligner&) = delete;
+  CoherentAligner& operator=(const CoherentAligner&) = delete;
+
+  struct Slot
+  {
+    CoherentAligner* owner = nullptr;
+    RtlDevCtx* dev = nullptr;
+    float* ring = nullptr;      // ring_len interleaved I/Q pairs
+
+    // RX thread: written up to (excluding) wr. claim is set before overwriting old samples
+    alignas(64) std::atomic_int64_t wr{ 0 };
+    std::atomic_int64_t claim{ 0 };
+    std::atomic_bool resync{ false };
+    // time of the last push - for the coarse offset. seqlock: odd while writing
+    std::atomic_uint32_t stamp_seq{ 0 };
+    std::atomic_int64_t stamp_idx{ 0 };
+    std::atomic_int64_t stamp_ns{ 0 };
+
+    // published offset
+    alignas(64) std::atomic_int64_t off{ 0 };
+    std::atomic<float> frac{ 0.0F };
+    std::atomic<float> phase{ 0.0F };
+    std::atomic<float> corr{ 0.0F };
+
+    // result of the running calibration round
+    int64_t cal_off = 0;
+    float cal_frac = 0.0F, cal_phase = 0.0F, cal_corr = 0.0F;
+    bool cal_ok = false;
+  };
+
+  struct Worker
+  {
+    CoherentAligner* owner = nullptr;
+    volatile void* thread = nullptr;
+    float* a_re = nullptr;
+    float* a_im = nullptr;
+    float* b_re = nullptr;
+    float* b_im = nullptr;
+    double* b_energy = nullptr;   // prefix sums of |b|^2
+  };
+
+  struct Job
+  {
+    unsigned dev;
+    int64_t i0;     // window start in device 0
+    int64_t guess;  // expected offset
+  };
+
+  static void rx_callback(RtlDevCtx& ctx, const uint8_t* iq, uint32_t n_iq_pairs, int64_t first_idx, void* user);
+  static void delivery_thread_proc(void* param);
+  static void worker_thread_proc(void* param);
+
+  void push(Slot& s, const uint8_t* iq, uint32_t n, int64_t first_idx);
+  // 1: copied, 0: not received yet, -1: lost (overwritten or before start)
+  int read_iq(const Slot& s, int64_t idx, uint32_t n, float* dst) const;
+  int read_split(const Slot& s, int64_t idx, uint32_t n, float* re, float* im) const;
+
+  int64_t coarse_offset(unsigned k) const;
+  bool schedule_calibration(int64_t i0);
+  bool dispatch_calibration();
+  void detect_bursts();
+  void deliver_blocks();
+  void correlate(Worker& w, const Job& j);
+  void finish_job();
+  void end_injection();
+
+  unsigned n_dev;
+  uint32_t block_len;
+  uint32_t ring_len;
+  unsigned n_workers;
+  double srate;
+
+  Slot slots[MAX_DEVICES];
+  Worker* workers;
+  FFT fft;    // shared: the transforms are const
+
+  BlockCallback callback;
+  void* callback_user;
+  InjectFn inject_fn;
+  void* inject_user;
+
+  // delivery thread
+  volatile void* delivery_thread;
+  void* data_event;
+  float* out[MAX_DEVICES];
+  float* det_buf;
+  int64_t out_pos;          // next block: index in device 0
+  unsigned out_generation;
+  bool out_realigned;
+  int64_t det_pos;
+  double det_avg;
+  unsigned det_chunks;
+  bool det_in_burst;
+  int64_t pending_i0;       // calibration waiting for its samples, -1 == none
+  int64_t pending_guess[MAX_DEVICES];
+  int64_t inject_deadline_ns;
+
+  // worker pool
+  void* job_sema;
+  std::mutex job_mutex;
+  Job jobs[MAX_DEVICES];
+  unsigned n_jobs;
+  unsigned jobs_outstanding;
+
+  std::atomic_bool terminate;
+  std::atomic_bool aligned;
+  std::atomic_uint cal_generation;
+  std::atomic_bool cal_request;
+  std::atomic_bool cal_busy;
+  std::atomic_bool detect_on;
+  std::atomic_bool detect_armed;    // one shot - for inject_burst()
+  std::atomic_bool injecting;
+  std::atomic<float> detect_ratio;
+  std::atomic<float> min_corr;
+  std::atomic_uint64_t overruns;
+};
@@ -4,10 +4,15 @@
 #include <toml++/toml.h>
 
 #include <shlobj_core.h>
+#include <process.h>
 
 #include <vector>
 #include <fstream>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 
 #ifdef _MSC_VER
 #pragma warning(disable : 4996)
@@ -24,6 +29,7 @@ static const std::string key_log("log");
 static const std::string key_band_name("name");
 static const std::string key_freq_from("freq_from");
 static const std::string key_freq_to("freq_to");
+static const std::string key_priority("priority");
 static const std::string key_sampling_mode("sampling_mode");
 static const std::string key_samplerate("samplerate");
 static const std::string key_tuner_bandwidth("tuner_bandwidth");
@@ -40,16 +46,60 @@ static const std::string key_gpio_button1("gpio_button1");
 static const std::string key_gpio_button2("gpio_button2");
 static const std::string key_gpio_button3("gpio_button3");
 static const std::string key_gpio_button4("gpio_button4");
+static const std::string key_notch_frequencies("notch_frequencies");
+static const std::string key_notch_bandwidth("notch_bandwidth");
 
 
 
-static std::vector<BandAction> band_actions;
-
-static BandAction::Band_Info band_status = BandAction::info_not_loaded;
+// all parsed bands of one config file - never modified after publishing
+struct BandTable
+{
+  std::vector<BandAction> bands;
+
+  // interval index over bands: sorted unique band edges.
+  //   at_edge[i]: winning band at exactly edges[i],
+  //   after_edge[i]: winning band between edges[i] and edges[i+1]. -1 == none
+  std::vector<double> edges;
+  std::vector<int> at_edge;
+  std::vector<int> after_edge;
+};
+
+// RCU: the watcher thread builds a complete new table and swaps the pointer.
+//   the reader (SetHWLO path) announces the table it uses in band_table_hazard,
+//   which keeps the table alive - also for the returned BandAction - until its next call.
+//   one slot suffices: the callers of update_band_action() hold nxt's writer lock.
+static std::atomic<BandTable*> band_table{ nullptr };
+static std::atomic<BandTable*> band_table_hazard{ nullptr };
+static std::vector<BandTable*> retired_tables;    // writer only
+static unsigned band_table_generation = 0;        // writer only
+
+static std::atomic<BandAction::Band_Info> band_status{ BandAction::info_not_loaded };
 
 static const BandAction initial_band_action{ "_init_", {}, -1.0, -1.0 };
 
+// interval of the index with constant winner: exactly lo (lo == hi) - or between lo and hi
+struct BandSlot
+{
+  double lo;
+  double hi;
+  bool contains(double f) const { return (lo == hi) ? (f == lo) : (lo < f && f < hi); }
+};
+
 static const BandAction* current_band_action = &initial_band_action;
+static const BandTable* current_band_table = nullptr;   // table of current_band_action
+// interval of the last lookup: the winner - current_band_action - is the same within
+static BandSlot current_slot{ 0.0, 0.0 };
+static bool current_slot_valid = false;
+// last lookup was outside of all bands. initially unknown: the first miss reports leaving
+static bool current_outside = false;
+
+// config file watcher
+static volatile HANDLE config_watch_handle = INVALID_HANDLE_VALUE;
+static HANDLE config_watch_stop = NULL;
+static WIN32_FILE_ATTRIBUTE_DATA config_stamp;
+
+static unsigned config_load_us = 0;
+static bool config_from_cache = false;
 
 
 static bool is_expected_value_type(
@@ -86,7 +136,25 @@ static bool is_expected_bool_type(
 }
 
 
-static void parse_band_action(const std::string& id, const toml::table& tbl, std::ofstream& info_out)
+static bool is_expected_array_type(
+  const std::string& id, const std::string& key, const std::string& expected_key,
+  const toml::node& val, std::ofstream& info_out)
+{
+  if (!key.compare(expected_key))
+  {
+    if (!val.is_array())
+    {
+      info_out << "error: '" << key << "' for band '" << id << "' is no array!\n";
+      return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+
+static void parse_band_action(const std::string& id, const toml::table& tbl, std::ofstream& info_out,
+  std::vector<BandAction>& bands)
 {
   BandAction ba;
   ba.id = id;
@@ -184,6 +252,9 @@ static void parse_band_action(const std::string& id, const toml::table& tbl, std
       }
     }
 
+    else if (is_expected_value_type(id, key, key_priority, val, info_out))
+      ba.priority = int(val.value<double>().value_or(0.0));
+
     else if (is_expected_value_type(id, key, key_samplerate, val, info_out))
       ba.samplerate = val.as_floating_point()->get();
 
@@ -226,6 +297,23 @@ static void parse_band_action(const std::string& id, const toml::table& tbl, std
     else if (is_expected_bool_type(id, key, key_gpio_button4, val, info_out))
       ba.gpio_button4 = val.as_boolean()->get();
 
+    else if (is_expected_value_type(id, key, key_notch_bandwidth, val, info_out))
+      ba.notch_bandwidth = val.value<double>();
+
+    else if (is_expected_array_type(id, key, key_notch_frequencies, val, info_out))
+    {
+      for (const toml::node& elem : *val.as_array())
+      {
+        const std::optional<double> f = elem.value<double>();
+        if (!f)
+        {
+          info_out << "error: '" << key << "' for band '" << id << "' contains a non-number!\n";
+          continue;
+        }
+        ba.notch_frequencies.push_back(f.value());
+      }
+    }
+
     else
     {
       info_out << "warning: '" << key << "' for band '" << id << "' is unknown.\n";
@@ -233,12 +321,13 @@ static void parse_band_action(const std::string& id, const toml::table& tbl, std
   }
 
   info_out << "info: adding band '" << id << "'\n";
-  band_actions.push_back(ba);
+  ba.index = unsigned(bands.size());
+  bands.push_back(ba);
 }
 
 
 static void print_toml_tables(int level, toml::table& tbl, std::ofstream& info_out,
-  const bool is_band = false
+  std::vector<BandAction>& bands, const bool is_band = false
 )
 {
   //info_out << "print_toml_tables(level " << level << ")\n";
@@ -252,9 +341,9 @@ static void print_toml_tables(int level, toml::table& tbl, std::ofstream& info_o
     else if (val.is_table())
     {
       info_out << "\n";
-      print_toml_tables(level + 1, *(val.as_table()), info_out, !key.compare("bands"));
+      print_toml_tables(level + 1, *(val.as_table()), info_out, bands, !key.compare("bands"));
       if (is_band)
-        parse_band_action(key, *(val.as_table()), info_out);
+        parse_band_action(key, *(val.as_table()), info_out, bands);
     }
     else if (val.is_boolean())
     {
@@ -277,6 +366,75 @@ static void print_toml_tables(int level, toml::table& tbl, std::ofstream& info_o
 }
 
 
+// is band a preferred over band b - both containing the frequency?
+static bool is_preferred_band(const std::vector<BandAction>& bands, int a, int b)
+{
+  if (b < 0)
+    return true;
+  const BandAction& A = bands[a];
+  const BandAction& B = bands[b];
+  if (A.priority != B.priority)
+    return A.priority > B.priority;
+  // same priority: the first parsed - as without priorities
+  return a < b;
+}
+
+static int find_band_linear(const std::vector<BandAction>& bands, double f)
+{
+  int best = -1;
+  for (int k = 0; k < int(bands.size()); ++k)
+  {
+    const BandAction& band = bands[k];
+    if (band.freq_from <= f && f <= band.freq_to && is_preferred_band(bands, k, best))
+      best = k;
+  }
+  return best;
+}
+
+// resolve the overlaps once at load time: lookup is a binary search
+static void build_band_index(BandTable& t)
+{
+  t.edges.clear();
+  t.at_edge.clear();
+  t.after_edge.clear();
+  for (const auto& band : t.bands)
+  {
+    t.edges.push_back(band.freq_from);
+    t.edges.push_back(band.freq_to);
+  }
+  std::sort(t.edges.begin(), t.edges.end());
+  t.edges.erase(std::unique(t.edges.begin(), t.edges.end()), t.edges.end());
+
+  const size_t n = t.edges.size();
+  for (size_t i = 0; i < n; ++i)
+  {
+    t.at_edge.push_back(find_band_linear(t.bands, t.edges[i]));
+    // the winner can't change between two edges: take the mid
+    t.after_edge.push_back((i + 1 < n)
+      ? find_band_linear(t.bands, 0.5 * (t.edges[i] + t.edges[i + 1]))
+      : -1);
+  }
+}
+
+static int find_band(const BandTable& t, double f, BandSlot& slot)
+{
+  auto it = std::upper_bound(t.edges.cbegin(), t.edges.cend(), f);
+  if (it == t.edges.cbegin())
+  {
+    slot = { -HUGE_VAL, t.edges.empty() ? HUGE_VAL : t.edges[0] };
+    return -1;  // below all bands
+  }
+  const size_t i = size_t(it - t.edges.cbegin()) - 1;
+  if (t.edges[i] == f)
+  {
+    slot = { f, f };
+    return t.at_edge[i];
+  }
+  slot = { t.edges[i], (i + 1 < t.edges.size()) ? t.edges[i + 1] : HUGE_VAL };
+  return t.after_edge[i];
+}
+
+
 static bool write_default_config(const char* fn)
 {
   auto tbl = toml::table{ {
@@ -290,6 +448,7 @@ static bool write_default_config(const char* fn)
           { "# name", "optional: band name to display" },
           { "# freq_from", "mandatory: low band edge: frequency in Hz" },
           { "# freq_to", "mandatory: high band edge: frequency in Hz" },
+          { "# priority", "optional: for overlapping bands: higher priority wins, then the first. default: 0" },
           { "# sampling_mode", "optional: 'I', 'Q' or 'C' for complex/both lines" },
           { "# samplerate", "optional: samplerate" },
           { "# tuner_bandwidth", "optional" },
@@ -306,6 +465,8 @@ static bool write_default_config(const char* fn)
           { "# gpio_button2", "optional" },
           { "# gpio_button3", "optional" },
           { "# gpio_button4", "optional" },
+          { "# notch_frequencies", "optional: array of spur frequencies in Hz to notch out" },
+          { "# notch_bandwidth", "optional: -3 dB bandwidth of each notch in Hz. default: 500" },
 
           { "1", toml::table{{
               { key_band_name, "0..13 MHz (HF-DS)" },
@@ -333,6 +494,7 @@ static bool write_default_config(const char* fn)
               { key_bias_tee, true },
               { key_tuner_rf_gain_db, 16.6 },
               { key_tuner_if_gain_db, 11.2 },
+              { key_notch_frequencies, toml::array{ 28.8e6, 57.6e6, 86.4e6 } },
           }} },
           { "4", toml::table{{
               { key_band_name, "108..300 MHz" },
@@ -367,36 +529,20 @@ static bool write_default_config(const char* fn)
 }
 
 
-const char* init_toml_config()
+static bool get_config_stamp(const char* fn, WIN32_FILE_ATTRIBUTE_DATA& stamp)
 {
-  // process only once
-  static bool processed = false;
-  if (processed)
-    return confFile;
-  processed = true;
-
-  strncpy(confFile, config_fn, MAX_PATH + MAX_PATH - 1);
-  confFile[MAX_PATH + MAX_PATH - 1] = 0;
-  const char* fn = confFile;
-  // prepend GetUserProfileDirectoryA() to config_fn ?
-  if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_PROFILE, NULL, 0, confFile)))
-  {
-    strncat(confFile, "\\", MAX_PATH + MAX_PATH - 1);
-    strncat(confFile, config_fn, MAX_PATH + MAX_PATH -1);
-    confFile[MAX_PATH + MAX_PATH - 1] = 0;
-    fn = confFile;
-  }
+  if (GetFileAttributesExA(fn, GetFileExInfoStandard, &stamp))
+    return true;
+  memset(&stamp, 0, sizeof(stamp));
+  return false;
+}
 
-  FILE* f = fopen(fn, "r");
-  if (!f)
-  {
-    // no config file => write one
-    bool write_ok = write_default_config(fn);
-    //if (!write_ok)
-    //    ;
-  }
 
+// parse config file into a new table. returns nullptr on parse error
+static BandTable* load_config(const char* fn, BandAction::Band_Info& status)
+{
   std::ofstream parsed_infos;
+  BandTable* t = new BandTable;
 
   toml::table tbl;
   bool parse_cfg = false;
@@ -414,60 +560,473 @@ const char* init_toml_config()
 
     if (parse_cfg)
     {
-      print_toml_tables(0, tbl, parsed_infos);
+      print_toml_tables(0, tbl, parsed_infos, t->bands);
+      build_band_index(*t);
 
-      if (!band_actions.size())
-        band_status = BandAction::Band_Info::info_no_bands;
+      if (!t->bands.size())
+        status = BandAction::Band_Info::info_no_bands;
       else
-        band_status = BandAction::Band_Info::info_ok;
+        status = BandAction::Band_Info::info_ok;
     }
     else
-      band_status = BandAction::Band_Info::info_disabled;
+      status = BandAction::Band_Info::info_disabled;
   }
   catch (const toml::parse_error& err)
   {
-    band_status = BandAction::Band_Info::info_parse_error;
+    status = BandAction::Band_Info::info_parse_error;
     parsed_infos << "Parsing failed : \n" << err << "\n";
+    delete t;
+    t = nullptr;
   }
 
   parsed_infos.close();
+  return t;
+}
+
+
+// binary cache of the parsed band table: skips toml parsing at startup.
+//   valid, when size and write time of the config file match.
+//   increment CACHE_VERSION with any change of BandAction or BandTable!
+static constexpr uint32_t CACHE_MAGIC = 0x42585452;   // "RTXB"
+static constexpr uint32_t CACHE_VERSION = 2;
+
+namespace
+{
+
+struct CacheHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size_high;
+  uint32_t size_low;
+  FILETIME write_time;
+  int32_t status;
+  uint32_t n_bands;
+};
+
+struct CacheWriter
+{
+  std::string buf;
+
+  template <typename T>
+  void put(const T& v) { buf.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+  void put(const std::string& s)
+  {
+    put(uint32_t(s.size()));
+    buf.append(s);
+  }
+  template <typename T>
+  void put(const std::optional<T>& v)
+  {
+    put(uint8_t(v ? 1 : 0));
+    if (v)
+      put(v.value());
+  }
+  template <typename T>
+  void put(const std::vector<T>& v)
+  {
+    put(uint32_t(v.size()));
+    for (const T& e : v)
+      put(e);
+  }
+};
+
+struct CacheReader
+{
+  const char* p;
+  const char* end;
+  bool ok = true;
+
+  template <typename T>
+  void get(T& v)
+  {
+    if (end - p < ptrdiff_t(sizeof(T)))
+    {
+      ok = false;
+      return;
+    }
+    memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+  }
+  void get(std::string& s)
+  {
+    uint32_t n = 0;
+    get(n);
+    if (!ok || end - p < ptrdiff_t(n))
+    {
+      ok = false;
+      return;
+    }
+    s.assign(p, n);
+    p += n;
+  }
+  template <typename T>
+  void get(std::optional<T>& v)
+  {
+    uint8_t has = 0;
+    get(has);
+    v.reset();
+    if (ok && has)
+    {
+      T t{};
+      get(t);
+      v = t;
+    }
+  }
+  template <typename T>
+  void get(std::vector<T>& v)
+  {
+    uint32_t n = 0;
+    get(n);
+    v.clear();
+    if (!ok || end - p < ptrdiff_t(n))  // at least 1 byte per element
+    {
+      ok = false;
+      return;
+    }
+    v.resize(n);
+    for (T& e : v)
+      get(e);
+  }
+};
+
+template <typename IO, typename BA>
+void serialize_band(IO& io, BA& ba)
+{
+  io.put_or_get(ba.id);
+  io.put_or_get(ba.name);
+  io.put_or_get(ba.freq_from);
+  io.put_or_get(ba.freq_to);
+  io.put_or_get(ba.priority);
+  io.put_or_get(ba.index);
+  io.put_or_get(ba.sampling_mode);
+  io.put_or_get(ba.samplerate);
+  io.put_or_get(ba.tuner_bandwidth);
+  io.put_or_get(ba.r820t_tuner_band_center);
+  io.put_or_get(ba.tuning_sideband);
+  io.put_or_get(ba.tuner_rf_agc);
+  io.put_or_get(ba.tuner_rf_gain_db);
+  io.put_or_get(ba.tuner_if_agc);
+  io.put_or_get(ba.tuner_if_gain_db);
+  io.put_or_get(ba.rtl_digital_agc);
+  io.put_or_get(ba.gpio_button0);
+  io.put_or_get(ba.gpio_button1);
+  io.put_or_get(ba.gpio_button2);
+  io.put_or_get(ba.gpio_button3);
+  io.put_or_get(ba.gpio_button4);
+  io.put_or_get(ba.notch_frequencies);
+  io.put_or_get(ba.notch_bandwidth);
+}
+
+struct CachePut : CacheWriter
+{
+  template <typename T>
+  void put_or_get(const T& v) { put(v); }
+};
+
+struct CacheGet : CacheReader
+{
+  template <typename T>
+  void put_or_get(T& v) { get(v); }
+};
+
+}
+
+
+static std::string cache_filename()
+{
+  return std::string(confFile) + ".cache";
+}
+
+
+static void save_config_cache(const BandTable& t, const WIN32_FILE_ATTRIBUTE_DATA& stamp, BandAction::Band_Info status)
+{
+  CacheHeader h;
+  h.magic = CACHE_MAGIC;
+  h.version = CACHE_VERSION;
+  h.size_high = stamp.nFileSizeHigh;
+  h.size_low = stamp.nFileSizeLow;
+  h.write_time = stamp.ftLastWriteTime;
+  h.status = int32_t(status);
+  h.n_bands = uint32_t(t.bands.size());
+
+  CachePut w;
+  w.put(h);
+  for (const auto& band : t.bands)
+    serialize_band(w, band);
+  w.put(t.edges);
+  w.put(t.at_edge);
+  w.put(t.after_edge);
+
+  // write complete file, then replace: a reader never sees a partial cache
+  const std::string fn = cache_filename();
+  const std::string tmp_fn = fn + ".tmp";
+  FILE* f = fopen(tmp_fn.c_str(), "wb");
+  if (!f)
+    return;
+  const bool ok = (fwrite(w.buf.data(), 1, w.buf.size(), f) == w.buf.size());
+  fclose(f);
+  if (!ok || !MoveFileExA(tmp_fn.c_str(), fn.c_str(), MOVEFILE_REPLACE_EXISTING))
+    DeleteFileA(tmp_fn.c_str());
+}
+
+
+// returns nullptr, when there is no valid cache for this stamp
+static BandTable* load_config_cache(const WIN32_FILE_ATTRIBUTE_DATA& stamp, BandAction::Band_Info& status)
+{
+  FILE* f = fopen(cache_filename().c_str(), "rb");
+  if (!f)
+    return nullptr;
+  std::string buf;
+  if (!fseek(f, 0, SEEK_END))
+  {
+    const long len = ftell(f);
+    if (len > 0 && !fseek(f, 0, SEEK_SET))
+    {
+      buf.resize(size_t(len));
+      if (fread(&buf[0], 1, buf.size(), f) != buf.size())
+        buf.clear();
+    }
+  }
+  fclose(f);
+
+  CacheGet r;
+  r.p = buf.data();
+  r.end = buf.data() + buf.size();
+  CacheHeader h;
+  r.get(h);
+  if (!r.ok || h.magic != CACHE_MAGIC || h.version != CACHE_VERSION
+    || h.size_high != stamp.nFileSizeHigh || h.size_low != stamp.nFileSizeLow
+    || CompareFileTime(&h.write_time, &stamp.ftLastWriteTime) != 0)
+    return nullptr;   // stale
+
+  BandTable* t = new BandTable;
+  t->bands.resize(h.n_bands);
+  for (auto& band : t->bands)
+    serialize_band(r, band);
+  r.get(t->edges);
+  r.get(t->at_edge);
+  r.get(t->after_edge);
+  if (!r.ok || r.p != r.end)
+  {
+    delete t;
+    return nullptr;
+  }
+  status = BandAction::Band_Info(h.status);
+  return t;
+}
+
+
+// writer side of RCU: swap in the new table. free old tables, which no reader uses
+static void publish_band_table(BandTable* t)
+{
+  if (t)
+  {
+    ++band_table_generation;
+    for (auto& band : t->bands)
+      band.generation = band_table_generation;
+  }
+  BandTable* old = band_table.exchange(t);
+  if (old)
+    retired_tables.push_back(old);
+
+  const BandTable* in_use = band_table_hazard.load();
+  for (size_t k = 0; k < retired_tables.size(); )
+  {
+    if (retired_tables[k] == in_use)
+      ++k;
+    else
+    {
+      delete retired_tables[k];
+      retired_tables.erase(retired_tables.begin() + k);
+    }
+  }
+}
+
+
+const char* init_toml_config()
+{
+  // process only once
+  static bool processed = false;
+  if (processed)
+    return confFile;
+  processed = true;
+
+  strncpy(confFile, config_fn, MAX_PATH + MAX_PATH - 1);
+  confFile[MAX_PATH + MAX_PATH - 1] = 0;
+  const char* fn = confFile;
+  // prepend GetUserProfileDirectoryA() to config_fn ?
+  if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_PROFILE, NULL, 0, confFile)))
+  {
+    strncat(confFile, "\\", MAX_PATH + MAX_PATH - 1);
+    strncat(confFile, config_fn, MAX_PATH + MAX_PATH -1);
+    confFile[MAX_PATH + MAX_PATH - 1] = 0;
+    fn = confFile;
+  }
+
+  FILE* f = fopen(fn, "r");
+  if (!f)
+  {
+    // no config file => write one
+    bool write_ok = write_default_config(fn);
+    //if (!write_ok)
+    //    ;
+  }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  get_config_stamp(fn, config_stamp);
+  BandAction::Band_Info status = BandAction::info_not_loaded;
+  BandTable* t = load_config_cache(config_stamp, status);
+  config_from_cache = (t != nullptr);
+  if (!t)
+  {
+    t = load_config(fn, status);
+    if (t)
+      save_config_cache(*t, config_stamp, status);
+  }
+  band_status = status;
+  publish_band_table(t);
+  config_load_us = unsigned(std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - t0).count());
   return fn;
 }
 
+unsigned get_config_load_us(bool& from_cache)
+{
+  from_cache = config_from_cache;
+  return config_load_us;
+}
+
 BandAction::Band_Info get_band_info()
 {
-  return band_status;
+  return band_status.load();
 }
 
 
-const BandAction* update_band_action(double new_frequency)
+// reader side of RCU: announce the table, then check it's still the published one
+static const BandTable* acquire_band_table()
 {
-  if (!band_actions.size())
-    return nullptr;
+  BandTable* t = band_table.load();
+  for (;;)
+  {
+    band_table_hazard.store(t);
+    BandTable* again = band_table.load();
+    if (again == t)
+      return t;
+    t = again;
+  }
+}
+
 
-  if (current_band_action
-    && current_band_action->freq_from <= new_frequency
-    && new_frequency <= current_band_action->freq_to
-    )
+const BandAction* update_band_action(double new_frequency, bool& left_all_bands)
+{
+  left_all_bands = false;
+  const BandTable* t = acquire_band_table();
+  if (!t || !t->bands.size())
   {
-    // still in last band
+    left_all_bands = !current_outside;
+    current_outside = true;
     return nullptr;
   }
 
-  // else: moved out of last band => no action
-  current_band_action = nullptr;
+  if (t != current_band_table)
+  {
+    // config got reloaded: old band isn't valid anymore => re-evaluate
+    current_band_table = t;
+    current_band_action = nullptr;
+    current_slot_valid = false;
+  }
+
+  // still in the interval of the last lookup: same winner. not the band's edges:
+  //   a nested band of higher priority wins inside the wide band
+  if (current_slot_valid && current_slot.contains(new_frequency))
+    return nullptr;
 
-  for (const auto& band : band_actions)
+  const int idx = find_band(*t, new_frequency, current_slot);
+  current_slot_valid = true;
+  const BandAction* winner = (idx >= 0) ? &t->bands[idx] : nullptr;
+  // also after a reload: the band of the old table was left
+  left_all_bands = !winner && !current_outside;
+  current_outside = !winner;
+  if (winner == current_band_action)
+    return nullptr;   // other interval - still in last band
+
+  // moved into new band => action. moved out of all bands => no action, but left_all_bands
+  current_band_action = winner;
+  return winner;
+}
+
+
+
+static void config_watch_proc(void* param)
+{
+  // watch the directory: the file itself might get replaced
+  char dir[MAX_PATH + MAX_PATH];
+  strcpy(dir, confFile);
+  char* sep = strrchr(dir, '\\');
+  if (sep)
+    *sep = 0;
+  else
+    strcpy(dir, ".");
+
+  HANDLE change = FindFirstChangeNotificationA(dir, FALSE,
+    FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+  if (change != INVALID_HANDLE_VALUE)
   {
-    if (band.freq_from <= new_frequency && new_frequency <= band.freq_to)
+    HANDLE events[2] = { config_watch_stop, change };
+    while (WaitForMultipleObjects(2, events, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
     {
-      // moved into new band => action
-      current_band_action = &band;
-      return current_band_action;
+      // editors write in several steps: give them some time
+      if (WaitForSingleObject(config_watch_stop, 200) == WAIT_OBJECT_0)
+        break;
+      FindNextChangeNotification(change);
+
+      // anything else in the directory?
+      WIN32_FILE_ATTRIBUTE_DATA stamp;
+      get_config_stamp(confFile, stamp);
+      if (!memcmp(&stamp, &config_stamp, sizeof(stamp)))
+        continue;
+      config_stamp = stamp;
+
+      BandAction::Band_Info status;
+      BandTable* t = load_config(confFile, status);
+      if (!t)
+        continue;   // keep the running band plan, when the new one is broken
+      save_config_cache(*t, stamp, status);
+      band_status = status;
+      publish_band_table(t);
     }
+    FindCloseChangeNotification(change);
   }
 
-  // no new band
-  return nullptr;
+  config_watch_handle = INVALID_HANDLE_VALUE;
+  _endthread();
 }
 
+
+int start_config_watch()
+{
+  if (config_watch_handle != INVALID_HANDLE_VALUE)
+    return 0;   // already running
+  if (!config_watch_stop)
+    config_watch_stop = CreateEvent(NULL, TRUE, FALSE, NULL);  // manual reset
+  if (!config_watch_stop)
+    return -1;
+  init_toml_config();
+  ResetEvent(config_watch_stop);
+  config_watch_handle = (HANDLE)_beginthread(config_watch_proc, 0, NULL);
+  if (config_watch_handle == INVALID_HANDLE_VALUE)
+    return -1;
+  return 0;
+}
+
+
+int stop_config_watch()
+{
+  if (config_watch_handle == INVALID_HANDLE_VALUE)
+    return 0;
+  SetEvent(config_watch_stop);
+  WaitForSingleObject(config_watch_handle, INFINITE);
+  config_watch_handle = INVALID_HANDLE_VALUE;
+  return 0;
+}
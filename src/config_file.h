@@ -23,6 +23,10 @@ struct BandAction
 
   double  freq_from;      // frequency in Hz - defining the band
   double  freq_to;        // frequency in Hz - defining the band
+  int     priority = 0;   // overlapping bands: higher wins. then the first
+
+  unsigned index = 0;       // position in its band table
+  unsigned generation = 0;  // of the band table: changes with each (re)load
 
   // all the optional settings
   std::optional<char>     sampling_mode;      // valid: "I", "Q", or "C" (or lowercase)
@@ -45,10 +49,23 @@ struct BandAction
   std::optional<bool>     gpio_button2;
   std::optional<bool>     gpio_button3;
   std::optional<bool>     gpio_button4;
+
+  std::vector<double>     notch_frequencies;  // absolute spur frequencies in Hz
+  std::optional<double>   notch_bandwidth;    // -3 dB bandwidth of each notch in Hz
 };
 
 const char* init_toml_config();
 
+// duration of init_toml_config() loading the bands - from binary cache or from toml
+unsigned get_config_load_us(bool& from_cache);
+
+// background thread: reloads the config file, when it changes.
+//   the new band table takes effect with the next frequency change
+int start_config_watch();
+int stop_config_watch();
+
 BandAction::Band_Info get_band_info();
 
-const BandAction* update_band_action(double new_frequency);
+// returns the new band's action - or nullptr without transition.
+//   left_all_bands: moved out of all bands, which also returns nullptr
+const BandAction* update_band_action(double new_frequency, bool& left_all_bands);
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <cstring>
 #include <atomic>
+#include <mutex>
 
 using CtrlFlagT = uint32_t;
 
@@ -29,54 +30,209 @@ struct CtrlFlags
 };
 
 
-struct ControlVars
+// parameter groups: each group is sent with one (or a few) librtlsdr commands
+struct CtrlGroup
+{
+  static constexpr unsigned freq = 0;
+  static constexpr unsigned srate = 1;
+  static constexpr unsigned tuner_bw = 2;
+  static constexpr unsigned rf_agc = 3;
+  static constexpr unsigned rf_gain = 4;
+  static constexpr unsigned if_agc_gain = 5;
+  static constexpr unsigned rtl_agc = 6;
+  static constexpr unsigned sampling_mode = 7;
+  static constexpr unsigned band_center = 8;
+  static constexpr unsigned offset_tuning = 9;
+  static constexpr unsigned tuner_sideband = 10;
+  static constexpr unsigned ppm_correction = 11;
+  static constexpr unsigned gpio0 = 12;     // .. gpio0 + NUM_GPIO_BUTTONS - 1
+  static constexpr unsigned rtl_impulse_nc = 17;
+  static constexpr unsigned rtl_aagc = 18;
+  static constexpr unsigned rtl_aagc_distrib = 19;
+  static constexpr unsigned NUM = 20;
+};
+
+
+// atomic control variable. a store into the tracking ControlVars (nxt)
+//   increments the version of the variable's group - when the value changes.
+//   Control_Changes() then only commands groups with new version
+template <typename T>
+class CtrlVar
+{
+public:
+  CtrlVar(std::atomic_uint32_t* group_version, T init)
+    : version(group_version)
+    , v(init)
+  { }
+
+  CtrlVar(const CtrlVar&) = delete;
+  CtrlVar& operator=(const CtrlVar&) = delete;
+
+  operator T() const { return v.load(); }
+  T load() const { return v.load(); }
+
+  void store(T n)
+  {
+    if (v.exchange(n) != n && version)
+      version->fetch_add(1);
+  }
+
+  CtrlVar& operator=(T n)
+  {
+    store(n);
+    return *this;
+  }
+
+private:
+  std::atomic_uint32_t* const version;
+  std::atomic<T> v;
+};
+
+
+struct ControlState;
+
+// own cache lines: no false sharing with the RX thread's atomics
+struct alignas(64) ControlVars
 {
   static constexpr unsigned NUM_GPIO_BUTTONS = 5;
 
+  // seqlock for writers, which change multiple variables at once - e.g. a band transition.
+  //   writers are serialized. single stores outside a batch stay valid
+  void begin_write();
+  void end_write();
+  // consistent copy of all values and versions - lock free for the reader
+  void snapshot(ControlState& s) const;
+
+  struct WriteBatch
+  {
+    explicit WriteBatch(ControlVars& cv) : c(cv) { c.begin_write(); }
+    ~WriteBatch() { c.end_write(); }
+    WriteBatch(const WriteBatch&) = delete;
+    WriteBatch& operator=(const WriteBatch&) = delete;
+    ControlVars& c;
+  };
+
+  // serializes with the writers - without opening a batch: snapshot() doesn't wait.
+  //   for work before the stores, e.g. resolving a band transition
+  struct WriterLock
+  {
+    explicit WriterLock(ControlVars& cv) : c(cv) { c.write_mutex.lock(); }
+    ~WriterLock() { c.write_mutex.unlock(); }
+    WriterLock(const WriterLock&) = delete;
+    WriterLock& operator=(const WriterLock&) = delete;
+    ControlVars& c;
+  };
+
   ControlVars(bool init_next)
+    : tracking(init_next)
   {
     for (unsigned k = 0; k < NUM_GPIO_BUTTONS; ++k)
       GPIO[k] = (init_next) ? 0 : -9;
   }
 
-  std::atomic_int64_t LO_freq = 100000000;
-  std::atomic_int64_t tune_freq = 0;  // absolute (RF) frequency of tuned frequency
-  std::atomic_int srate_idx = 21;     // default = 2.3 MSps
-  std::atomic_int tuner_bw = 0;       // 0 == automatic, sonst in Hz
+  // nxt: incremented at each change. last: applied version
+  const bool tracking;
+  std::atomic_uint32_t version[CtrlGroup::NUM] = {};
+
+  CtrlVar<int64_t> LO_freq{ ver(CtrlGroup::freq), 100000000 };
+  CtrlVar<int64_t> tune_freq{ nullptr, 0 };  // absolute (RF) frequency of tuned frequency
+  CtrlVar<int> srate_idx{ ver(CtrlGroup::srate), 21 };     // default = 2.3 MSps
+  CtrlVar<int> tuner_bw{ ver(CtrlGroup::tuner_bw), 0 };    // 0 == automatic, sonst in Hz
                           // n_bandwidths = bandwidths[]; nearestBwIdx()
-  std::atomic_int decimation = 1;
-  std::atomic_int rf_gain = 1;
-  std::atomic_int if_gain_val = 1;
-  std::atomic_int if_gain_idx = 1;
-  std::atomic_int tuner_rf_agc = 1;   // 0 == off/manual, 1 == on/automatic
-  std::atomic_int tuner_if_agc = 0;   // 0 == off/manual, 1 == on/automatic
-  std::atomic_int rtl_agc = 1;
-  std::atomic_int sampling_mode = 0;
-  std::atomic_int band_center_sel = 0;
-  std::atomic_int band_center_LO_delta = 0;
-  std::atomic_int offset_tuning = 0;
-  std::atomic_int USB_sideband = 0;
-  std::atomic_int freq_corr_ppm = 0;
-  std::atomic_int GPIO[NUM_GPIO_BUTTONS];
-
-  std::atomic_int rtl_impulse_noise_cancellation = -1;
-
-  std::atomic_int rtl_aagc_rf_en = -1;
-  std::atomic_int rtl_aagc_rf_inv = -1;
-  std::atomic_int rtl_aagc_rf_min = -1;
-  std::atomic_int rtl_aagc_rf_max = -1;
-
-  std::atomic_int rtl_aagc_if_en = -1;
-  std::atomic_int rtl_aagc_if_inv = -1;
-  std::atomic_int rtl_aagc_if_min = -1;
-  std::atomic_int rtl_aagc_if_max = -1;
-
-  std::atomic_int rtl_aagc_lg_lock = -1;  // lg: loop gain
-  std::atomic_int rtl_aagc_lg_unlock = -1;
-  std::atomic_int rtl_aagc_lg_ifr = -1;  // ifr: interference
-
-  std::atomic_int rtl_aagc_vtop[3] = { -1, -1, -1 };
-  std::atomic_int rtl_aagc_krf[4] = { -1, -1, -1, -1 };
+  CtrlVar<int> decimation{ nullptr, 1 };
+  CtrlVar<int> rf_gain{ ver(CtrlGroup::rf_gain), 1 };
+  CtrlVar<int> if_gain_val{ ver(CtrlGroup::if_agc_gain), 1 };
+  CtrlVar<int> if_gain_idx{ ver(CtrlGroup::if_agc_gain), 1 };
+  CtrlVar<int> tuner_rf_agc{ ver(CtrlGroup::rf_agc), 1 };      // 0 == off/manual, 1 == on/automatic
+  CtrlVar<int> tuner_if_agc{ ver(CtrlGroup::if_agc_gain), 0 }; // 0 == off/manual, 1 == on/automatic
+  CtrlVar<int> rtl_agc{ ver(CtrlGroup::rtl_agc), 1 };
+  CtrlVar<int> sampling_mode{ ver(CtrlGroup::sampling_mode), 0 };
+  CtrlVar<int> band_center_sel{ ver(CtrlGroup::band_center), 0 };
+  CtrlVar<int> band_center_LO_delta{ ver(CtrlGroup::band_center), 0 };
+  CtrlVar<int> offset_tuning{ ver(CtrlGroup::offset_tuning), 0 };
+  CtrlVar<int> USB_sideband{ ver(CtrlGroup::tuner_sideband), 0 };
+  CtrlVar<int> freq_corr_ppm{ ver(CtrlGroup::ppm_correction), 0 };
+  CtrlVar<int> GPIO[NUM_GPIO_BUTTONS] = {
+    { ver(CtrlGroup::gpio0 + 0), 0 }, { ver(CtrlGroup::gpio0 + 1), 0 }, { ver(CtrlGroup::gpio0 + 2), 0 },
+    { ver(CtrlGroup::gpio0 + 3), 0 }, { ver(CtrlGroup::gpio0 + 4), 0 }
+  };
+
+  CtrlVar<int> rtl_impulse_noise_cancellation{ ver(CtrlGroup::rtl_impulse_nc), -1 };
+
+  CtrlVar<int> rtl_aagc_rf_en{ ver(CtrlGroup::rtl_aagc), -1 };
+  CtrlVar<int> rtl_aagc_rf_inv{ ver(CtrlGroup::rtl_aagc), -1 };
+  CtrlVar<int> rtl_aagc_rf_min{ ver(CtrlGroup::rtl_aagc), -1 };
+  CtrlVar<int> rtl_aagc_rf_max{ ver(CtrlGroup::rtl_aagc), -1 };
+
+  CtrlVar<int> rtl_aagc_if_en{ ver(CtrlGroup::rtl_aagc), -1 };
+  CtrlVar<int> rtl_aagc_if_inv{ ver(CtrlGroup::rtl_aagc), -1 };
+  CtrlVar<int> rtl_aagc_if_min{ ver(CtrlGroup::rtl_aagc), -1 };
+  CtrlVar<int> rtl_aagc_if_max{ ver(CtrlGroup::rtl_aagc), -1 };
+
+  CtrlVar<int> rtl_aagc_lg_lock{ ver(CtrlGroup::rtl_aagc), -1 };  // lg: loop gain
+  CtrlVar<int> rtl_aagc_lg_unlock{ ver(CtrlGroup::rtl_aagc), -1 };
+  CtrlVar<int> rtl_aagc_lg_ifr{ ver(CtrlGroup::rtl_aagc), -1 };  // ifr: interference
+
+  CtrlVar<int> rtl_aagc_vtop[3] = {
+    { ver(CtrlGroup::rtl_aagc_distrib), -1 }, { ver(CtrlGroup::rtl_aagc_distrib), -1 },
+    { ver(CtrlGroup::rtl_aagc_distrib), -1 }
+  };
+  CtrlVar<int> rtl_aagc_krf[4] = {
+    { ver(CtrlGroup::rtl_aagc_distrib), -1 }, { ver(CtrlGroup::rtl_aagc_distrib), -1 },
+    { ver(CtrlGroup::rtl_aagc_distrib), -1 }, { ver(CtrlGroup::rtl_aagc_distrib), -1 }
+  };
+
+private:
+  std::atomic_uint32_t* ver(unsigned group) { return (tracking) ? &version[group] : nullptr; }
+
+  alignas(64) std::atomic_uint32_t seq{ 0 };   // odd while writing
+  std::recursive_mutex write_mutex;
+  int write_depth = 0;
+};
+
+
+// plain copy of ControlVars. see ControlVars::snapshot()
+struct ControlState
+{
+  uint32_t version[CtrlGroup::NUM];
+
+  int64_t LO_freq;
+  int64_t tune_freq;
+  int srate_idx;
+  int tuner_bw;
+  int decimation;
+  int rf_gain;
+  int if_gain_val;
+  int if_gain_idx;
+  int tuner_rf_agc;
+  int tuner_if_agc;
+  int rtl_agc;
+  int sampling_mode;
+  int band_center_sel;
+  int band_center_LO_delta;
+  int offset_tuning;
+  int USB_sideband;
+  int freq_corr_ppm;
+  int GPIO[ControlVars::NUM_GPIO_BUTTONS];
+
+  int rtl_impulse_noise_cancellation;
+
+  int rtl_aagc_rf_en;
+  int rtl_aagc_rf_inv;
+  int rtl_aagc_rf_min;
+  int rtl_aagc_rf_max;
+
+  int rtl_aagc_if_en;
+  int rtl_aagc_if_inv;
+  int rtl_aagc_if_min;
+  int rtl_aagc_if_max;
+
+  int rtl_aagc_lg_lock;
+  int rtl_aagc_lg_unlock;
+  int rtl_aagc_lg_ifr;
+
+  int rtl_aagc_vtop[3];
+  int rtl_aagc_krf[4];
 };
 
 extern std::atomic_int GPIO_pin[ControlVars::NUM_GPIO_BUTTONS];
@@ -124,26 +280,72 @@ static constexpr unsigned MAX_RTL_DEVICES = 16;
 
 extern RtlDeviceInfo RtlDeviceList[MAX_RTL_DEVICES];
 extern RtlDeviceInfo RtlOpenDevice;
+// tuner type of the last opened device: still valid after close_rtl_device() - e.g. after a loss
+extern std::atomic_uint32_t RtlOpenTunerType;
 extern uint32_t RtlNumDevices;
 extern uint32_t RtlSelectedDeviceIdx;  // index into RtlDeviceList[]
 
 extern rtlsdr_dev_t* RtlSdrDev;
 
+// fills RtlDeviceList[] from the enumeration cache - without waiting for USB
 uint32_t retrieve_devices();
+// enumerates into the cache. slow: opens each device. returns the list version
+uint32_t enumerate_devices();
+// cached device with this serial - false, when not found or not unique
+bool find_cached_device(const char* serial, RtlDeviceInfo& info);
+// wakes the DevEnum thread. false, when it isn't running
+bool request_device_enumeration();
 bool is_device_handle_valid();
 void close_rtl_device();
 bool open_selected_rtl_device();
+// before open: tuner type from the tuner cache - for the GUI. false, when not cached
+bool preset_tuner_from_cache();
 
 bool Control_Changes();
 
+// serializes librtlsdr calls, which read the USB strings or open a device, with the
+//   device enumeration - also for devices opened outside of control_tcp.cpp.
+//   lock order: control_mutex, then this lock
+std::unique_lock<std::mutex> lock_rtl_enumeration();
+
+// 1 == read back device state in Control_Changes() for the log. costs USB transfers
+extern std::atomic_int control_diagnostics;
+
+// true, when all groups were commanded to the open device: 'last' reflects the hardware.
+//   cleared at close. with fast_start, StartHW() then only sends the changes
+extern std::atomic_bool hw_state_valid;
+extern std::atomic_int fast_start;
+
+// control path: after a change of the delivered samplerate.
+//   while streaming, the RX thread signals extHw_Changed_SampleRate to the host with the
+//   first block received after the change - and flushes the conversion stages.
+//   returns false, when not delivering: then the caller has to signal
+bool rx_mark_srate_change();
+
 extern std::atomic_uint32_t tunerNo;
 extern std::atomic_bool GotTunerInfo;
 
 int nearestBwIdx(int bw);
+// frequency to tune the hardware to: shifted by fs/4 with real to complex conversion
+uint64_t hw_center_freq(uint64_t lo_freq, int sampling_mode, int srate_idx);
 int nearestGainIdx(int gain, const int* gains, const int n_gains);
 
-inline void trigger_control(CtrlFlagT f)
+// control thread: serializes all Control_Changes(). trigger_control() just queues
+//   the flags and returns immediately - or executes synchronously, when the thread
+//   isn't running
+int Start_Control_Thread();
+int Stop_Control_Thread();
+void trigger_control(CtrlFlagT f);
+
+// bursts of frequency changes are coalesced: only the latest LO gets tuned.
+//   additionally, retunes are not commanded faster than this interval. 0 == no limit
+extern std::atomic_int min_retune_interval_ms;
+
+struct RetuneStats
 {
-  somewhat_changed.fetch_or(f);
-  Control_Changes();
-}
+  uint64_t requested;   // trigger_control() calls with CtrlFlags::freq
+  uint64_t applied;     // Control_Changes() runs for them
+  uint64_t elided;      // requests, which were merged into a later one
+};
+
+RetuneStats get_retune_stats();
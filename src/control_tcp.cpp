@@ -2,12 +2,21 @@
 #include "control.h"
 #include "rates.h"
 #include "tuners.h"
+#include "notch.h"
+#include "real2cplx.h"
+#include "settle.h"
+#include "latency.h"
+#include "tuner_cache.h"
+#include "standby.h"
 
 #include "LC_ExtIO_Types.h"
 
 #include <stdio.h>
 #include <assert.h>
+#include <chrono>
 #include <cmath>
+#include <mutex>
+#include <thread>
 
 
 #ifdef _MSC_VER
@@ -17,6 +26,19 @@
 
 #define N_TUNER_RETRIES  1
 
+// serializes device open/close and Control_Changes() between control thread,
+//   GUI, ConnCheck and the exported functions
+static std::recursive_mutex control_mutex;
+
+// 1 == read back tuner/demodulator state for the log: additional USB transfers!
+std::atomic_int control_diagnostics = 0;
+
+std::atomic_bool hw_state_valid = false;
+std::atomic_int fast_start = 1;
+
+// shadow of the written frequency correction: librtlsdr starts with 0 ppm after open
+static int shadow_ppm = 0;
+
 //                                                       A  B  C  D  E
 std::atomic_int GPIO_pin[ControlVars::NUM_GPIO_BUTTONS] = { 0, 1, 2, 4, 5 };
 std::atomic_int GPIO_inv[ControlVars::NUM_GPIO_BUTTONS] = { 0, 0, 0, 0, 0 };
@@ -59,6 +81,7 @@ bool RtlDeviceInfo::is_same(const RtlDeviceInfo& A, const RtlDeviceInfo& B)
 
 RtlDeviceInfo RtlDeviceList[MAX_RTL_DEVICES];
 RtlDeviceInfo RtlOpenDevice;
+std::atomic_uint32_t RtlOpenTunerType = RTLSDR_TUNER_UNKNOWN;   // kept at close
 uint32_t RtlNumDevices = 0;
 uint32_t RtlSelectedDeviceIdx = 0;
 
@@ -85,6 +108,73 @@ extern pfnExtIOCallback gpfnExtIOCallbackPtr;
 static constexpr unsigned NUM_GPIO_BUTTONS = ControlVars::NUM_GPIO_BUTTONS;
 
 
+void ControlVars::begin_write()
+{
+  write_mutex.lock();
+  if (write_depth++ == 0)
+    seq.fetch_add(1, std::memory_order_acq_rel);   // odd
+}
+
+void ControlVars::end_write()
+{
+  if (--write_depth == 0)
+    seq.fetch_add(1, std::memory_order_release);   // even
+  write_mutex.unlock();
+}
+
+void ControlVars::snapshot(ControlState& s) const
+{
+  for (;;)
+  {
+    const uint32_t seq0 = seq.load(std::memory_order_acquire);
+    if (seq0 & 1U)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    for (unsigned g = 0; g < CtrlGroup::NUM; ++g)
+      s.version[g] = version[g].load();
+    s.LO_freq = LO_freq.load();
+    s.tune_freq = tune_freq.load();
+    s.srate_idx = srate_idx.load();
+    s.tuner_bw = tuner_bw.load();
+    s.decimation = decimation.load();
+    s.rf_gain = rf_gain.load();
+    s.if_gain_val = if_gain_val.load();
+    s.if_gain_idx = if_gain_idx.load();
+    s.tuner_rf_agc = tuner_rf_agc.load();
+    s.tuner_if_agc = tuner_if_agc.load();
+    s.rtl_agc = rtl_agc.load();
+    s.sampling_mode = sampling_mode.load();
+    s.band_center_sel = band_center_sel.load();
+    s.band_center_LO_delta = band_center_LO_delta.load();
+    s.offset_tuning = offset_tuning.load();
+    s.USB_sideband = USB_sideband.load();
+    s.freq_corr_ppm = freq_corr_ppm.load();
+    s.rtl_impulse_noise_cancellation = rtl_impulse_noise_cancellation.load();
+    s.rtl_aagc_rf_en = rtl_aagc_rf_en.load();
+    s.rtl_aagc_rf_inv = rtl_aagc_rf_inv.load();
+    s.rtl_aagc_rf_min = rtl_aagc_rf_min.load();
+    s.rtl_aagc_rf_max = rtl_aagc_rf_max.load();
+    s.rtl_aagc_if_en = rtl_aagc_if_en.load();
+    s.rtl_aagc_if_inv = rtl_aagc_if_inv.load();
+    s.rtl_aagc_if_min = rtl_aagc_if_min.load();
+    s.rtl_aagc_if_max = rtl_aagc_if_max.load();
+    s.rtl_aagc_lg_lock = rtl_aagc_lg_lock.load();
+    s.rtl_aagc_lg_unlock = rtl_aagc_lg_unlock.load();
+    s.rtl_aagc_lg_ifr = rtl_aagc_lg_ifr.load();
+    for (unsigned k = 0; k < NUM_GPIO_BUTTONS; ++k)
+      s.GPIO[k] = GPIO[k].load();
+    for (unsigned k = 0; k < 3; ++k)
+      s.rtl_aagc_vtop[k] = rtl_aagc_vtop[k].load();
+    for (unsigned k = 0; k < 4; ++k)
+      s.rtl_aagc_krf[k] = rtl_aagc_krf[k].load();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq.load(std::memory_order_relaxed) == seq0)
+      return;
+  }
+}
+
 static inline void clear_flag(CtrlFlagT& flags, CtrlFlagT f)
 {
   flags &= ~f;
@@ -97,6 +187,23 @@ static inline bool isR82XX()
   return (RTLSDR_TUNER_R820T == t || RTLSDR_TUNER_R828D == t || RTLSDR_TUNER_BLOG_V4 == t);
 }
 
+// samplerate delivered to the host: halved with real to complex conversion
+static int delivered_srate(int sampling_mode, int srate_idx)
+{
+  const int fs = rates::tab[srate_idx].valueInt;
+  return real2cplx_active(sampling_mode) ? fs / 2 : fs;
+}
+
+// frequency to tune the hardware to: with real to complex conversion,
+//   the delivered complex baseband is centered at fs/4 of the real ADC branch
+uint64_t hw_center_freq(uint64_t lo_freq, int sampling_mode, int srate_idx)
+{
+  if (!real2cplx_active(sampling_mode))
+    return lo_freq;
+  const uint64_t fs_4 = uint64_t(rates::tab[srate_idx].valueInt / 4);
+  return (lo_freq > fs_4) ? lo_freq - fs_4 : 0;
+}
+
 int nearestBwIdx(int bw)
 {
   if (bw <= 0 || n_bandwidths <= 0)
@@ -144,10 +251,77 @@ int nearestGainIdx(int gain, const int* gains, const int n_gains)
 }
 
 
-uint32_t retrieve_devices()
+// device enumeration cache: rtlsdr_get_device_usb_strings() opens each device and reads
+//   its string descriptors - slow. enumerate_devices() runs in the DevEnum thread
+//   (or synchronous, when that isn't running) into a double buffer: readers take a copy
+//   of the front buffer - with a seqlock per buffer, without waiting for an enumeration
+struct DeviceListBuf
 {
-  // const uint32_t prevRtlNumDevices = RtlNumDevices;
-  RtlNumDevices = 0;
+  std::atomic_uint32_t seq{ 0 };   // odd while writing
+  uint32_t version = 0;
+  uint32_t n = 0;
+  RtlDeviceInfo dev[MAX_RTL_DEVICES];
+};
+
+static DeviceListBuf device_list_buf[2];
+static std::atomic_int device_list_front = 0;
+static std::atomic_uint32_t device_list_version = 0;
+static std::atomic_int64_t device_list_time_ms = 0;   // of the last enumeration
+// a list younger than this is used without refresh - e.g. OpenHW() and its GUI init
+static constexpr int64_t DEVICE_LIST_MAX_AGE_MS = 1000;
+
+static int64_t now_ms()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// serializes the enumeration with rtlsdr_open(): on Windows the device can only be
+//   opened once - an enumeration, which just reads the strings, would let the open fail.
+//   lock order: control_mutex, then enumerate_mutex
+static std::mutex enumerate_mutex;
+static RtlDeviceInfo enum_open_device;    // copy of RtlOpenDevice - guarded by enumerate_mutex
+
+std::unique_lock<std::mutex> lock_rtl_enumeration()
+{
+  return std::unique_lock<std::mutex>(enumerate_mutex);
+}
+
+static uint32_t read_device_list(RtlDeviceInfo* list, uint32_t& n)
+{
+  for (;;)
+  {
+    const DeviceListBuf& b = device_list_buf[device_list_front.load(std::memory_order_acquire)];
+    const uint32_t seq = b.seq.load(std::memory_order_acquire);
+    if (seq & 1)
+      continue;
+    const uint32_t version = b.version;
+    n = b.n;
+    for (uint32_t k = 0; k < n && k < MAX_RTL_DEVICES; ++k)
+      list[k] = b.dev[k];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (b.seq.load(std::memory_order_relaxed) == seq)
+      return version;
+  }
+}
+
+static bool is_same_list(const RtlDeviceInfo* A, uint32_t nA, const RtlDeviceInfo* B, uint32_t nB)
+{
+  if (nA != nB)
+    return false;
+  for (uint32_t k = 0; k < nA; ++k)
+  {
+    if (A[k].dev_idx != B[k].dev_idx || !RtlDeviceInfo::is_same(A[k], B[k]))
+      return false;
+  }
+  return true;
+}
+
+uint32_t enumerate_devices()
+{
+  static RtlDeviceInfo found[MAX_RTL_DEVICES];   // guarded by enumerate_mutex
+  std::lock_guard<std::mutex> lock(enumerate_mutex);
+  uint32_t n_found = 0;
   bool replaced_open_dev = false;
   uint32_t N = rtlsdr_get_device_count();
   if (N > MAX_RTL_DEVICES)
@@ -155,20 +329,20 @@ uint32_t retrieve_devices()
 
   for (uint32_t k = 0; k < N; ++k)
   {
-    RtlDeviceInfo& dev_info = RtlDeviceList[RtlNumDevices];
+    RtlDeviceInfo& dev_info = found[n_found];
     dev_info.clear();
 
     int r = rtlsdr_get_device_usb_strings(k, dev_info.vendor, dev_info.product, dev_info.serial);
     if (r < 0)
     {
-      if (RtlSdrDev && !replaced_open_dev)
+      // the opened device doesn't deliver its strings
+      if (enum_open_device.dev_idx < MAX_RTL_DEVICES && !replaced_open_dev)
       {
-        // int r = rtlsdr_get_usb_strings(RtlSdrDev, dev_info.vendor, dev_info.product, dev_info.serial);
-        dev_info = RtlOpenDevice;
+        dev_info = enum_open_device;
         snprintf(dev_info.name, 255, "%s / %s / %s (*)",
-          RtlOpenDevice.vendor,
-          RtlOpenDevice.product,
-          RtlOpenDevice.serial);
+          enum_open_device.vendor,
+          enum_open_device.product,
+          enum_open_device.serial);
         dev_info.name[255] = 0;
         replaced_open_dev = true;
       }
@@ -186,8 +360,73 @@ uint32_t retrieve_devices()
         dev_info.serial);
       dev_info.name[255] = 0;
     }
-    ++RtlNumDevices;
+    ++n_found;
+  }
+
+  // publish - only, when something changed
+  device_list_time_ms = now_ms();
+  const int front = device_list_front.load();
+  DeviceListBuf& cur = device_list_buf[front];
+  if (device_list_version.load() && is_same_list(cur.dev, cur.n, found, n_found))
+    return cur.version;
+
+  DeviceListBuf& b = device_list_buf[1 - front];
+  const uint32_t seq = b.seq.load(std::memory_order_relaxed);
+  b.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  b.version = device_list_version.load() + 1;
+  b.n = n_found;
+  for (uint32_t k = 0; k < n_found; ++k)
+    b.dev[k] = found[k];
+  b.seq.store(seq + 2, std::memory_order_release);
+  device_list_front.store(1 - front, std::memory_order_release);
+  device_list_version.store(b.version);
+
+  char acMsg[256];
+  SDRLG(extHw_MSG_DEBUG, "enumerate_devices(): found %u devices - list version %u:", n_found, b.version);
+  for (unsigned k = 0; k < n_found; ++k)
+    SDRLG(extHw_MSG_DEBUG, "enumerate_devices(): dev %u: %s", unsigned(found[k].dev_idx), found[k].name);
+  return b.version;
+}
+
+// unique match of a non empty serial. dongles with the default serial can't be told apart
+bool find_cached_device(const char* serial, RtlDeviceInfo& info)
+{
+  static thread_local RtlDeviceInfo list[MAX_RTL_DEVICES];
+  uint32_t n = 0;
+  if (!serial[0])
+    return false;
+  read_device_list(list, n);
+  int found = -1;
+  for (uint32_t k = 0; k < n; ++k)
+  {
+    if (!strncmp(list[k].serial, serial, sizeof(list[k].serial)))
+    {
+      if (found >= 0)
+        return false;   // ambiguous
+      found = int(k);
+    }
   }
+  if (found < 0)
+    return false;
+  info = list[found];
+  return true;
+}
+
+uint32_t retrieve_devices()
+{
+  // the first list is enumerated synchronous. later the cached list is returned
+  //   immediately - and a refresh is requested from the DevEnum thread
+  const bool fresh = device_list_version.load() && now_ms() - device_list_time_ms.load() < DEVICE_LIST_MAX_AGE_MS;
+  if (!fresh && (!device_list_version.load() || !request_device_enumeration()))
+    enumerate_devices();
+
+  // selection follows the serial, when the device indices changed
+  RtlDeviceInfo selected;
+  if (RtlSelectedDeviceIdx < RtlNumDevices)
+    selected = RtlDeviceList[RtlSelectedDeviceIdx];
+
+  read_device_list(RtlDeviceList, RtlNumDevices);
 
   if (!RtlNumDevices)
   {
@@ -199,16 +438,22 @@ uint32_t retrieve_devices()
     ++RtlNumDevices;
   }
 
-  if (RtlSelectedDeviceIdx >= RtlNumDevices)
-    RtlSelectedDeviceIdx = 0;
-
-  char acMsg[256];
-  SDRLG(extHw_MSG_DEBUG, "retrieve_devices(): found %u devices:", RtlNumDevices);
-  for (unsigned k = 0; k < RtlNumDevices; ++k)
+  if (selected.serial[0])
   {
-    RtlDeviceInfo& dev_info = RtlDeviceList[k];
-    SDRLG(extHw_MSG_DEBUG, "retrieve_devices(): dev %u: %s", unsigned(dev_info.dev_idx), dev_info.name);
+    unsigned n_match = 0, match = 0;
+    for (unsigned k = 0; k < RtlNumDevices; ++k)
+    {
+      if (!strncmp(RtlDeviceList[k].serial, selected.serial, sizeof(selected.serial)))
+      {
+        ++n_match;
+        match = k;
+      }
+    }
+    if (n_match == 1)
+      RtlSelectedDeviceIdx = match;
   }
+  if (RtlSelectedDeviceIdx >= RtlNumDevices)
+    RtlSelectedDeviceIdx = 0;
 
   return RtlNumDevices;
 }
@@ -234,18 +479,72 @@ bool is_device_handle_valid()
 
 void close_rtl_device()
 {
+  std::lock_guard<std::recursive_mutex> lock(control_mutex);
   char acMsg[256];
   if (RtlSdrDev)
     SDRLG(extHw_MSG_DEBUG, "close_rtl_device(handle 0x%p)", RtlSdrDev);
   rtlsdr_close(RtlSdrDev);
   RtlSdrDev = 0;
+  hw_state_valid = false;
   tunerNo = RTLSDR_TUNER_UNKNOWN;
   GotTunerInfo = false;
   RtlOpenDevice.clear();
+  std::lock_guard<std::mutex> enum_lock(enumerate_mutex);
+  enum_open_device.clear();
+}
+
+// gain and bandwidth tables of tunerNo. adjusts the requested values to available ones
+static void update_tuner_tables()
+{
+  // update bandwidths
+  bandwidths = tuners::bws[tunerNo].bw;
+  n_bandwidths = tuners::bws[tunerNo].num;
+  if (n_bandwidths)
+  {
+    int bwIdx = nearestBwIdx(nxt.tuner_bw);
+    nxt.tuner_bw = bandwidths[bwIdx];
+  }
+
+  // update hf gains
+  rf_gains = tuners::rf_gains[tunerNo].gain;
+  n_rf_gains = tuners::rf_gains[tunerNo].num;
+  if (n_rf_gains)
+  {
+    int gainIdx = nearestGainIdx(nxt.rf_gain, rf_gains, n_rf_gains);
+    nxt.rf_gain = rf_gains[gainIdx];
+  }
+
+  // update if gains
+  if_gains = tuners::if_gains[tunerNo].gain;
+  n_if_gains = tuners::if_gains[tunerNo].num;
+  if (n_if_gains)
+  {
+    nxt.if_gain_idx = nearestGainIdx(nxt.if_gain_val, if_gains, n_if_gains);
+    nxt.if_gain_val = if_gains[nxt.if_gain_idx];
+  }
+}
+
+// before open: tuner type of the selected device from the cache.
+//   the GUI gets the tuner specific controls - without waiting for open and probe
+bool preset_tuner_from_cache()
+{
+  std::lock_guard<std::recursive_mutex> lock(control_mutex);
+  char acMsg[256];
+  if (RtlSdrDev || RtlSelectedDeviceIdx >= RtlNumDevices
+    || RtlDeviceList[RtlSelectedDeviceIdx].dev_idx >= MAX_RTL_DEVICES)
+    return false;
+  uint32_t t;
+  if (!tuner_cache_lookup(RtlDeviceList[RtlSelectedDeviceIdx], t) || t >= tuners::N)
+    return false;
+  tunerNo = t;
+  update_tuner_tables();
+  SDRLG(extHw_MSG_DEBUG, "tuner cache: '%s' has tuner type %s", RtlDeviceList[RtlSelectedDeviceIdx].name, tuners::names[t]);
+  return true;
 }
 
 bool open_selected_rtl_device()
 {
+  std::lock_guard<std::recursive_mutex> lock(control_mutex);
   char acMsg[256];
   close_rtl_device();
 
@@ -254,16 +553,31 @@ bool open_selected_rtl_device()
     return false;
 
   RtlOpenDevice = RtlDeviceList[RtlSelectedDeviceIdx];
+
+  // USB indices shift, when devices come or go: take the index from the newest enumeration
+  RtlDeviceInfo cached;
+  if (find_cached_device(RtlOpenDevice.serial, cached) && cached.dev_idx != RtlOpenDevice.dev_idx)
+  {
+    SDRLG(extHw_MSG_DEBUG, "device with serial '%s' moved from index %u to %u",
+      RtlOpenDevice.serial, unsigned(RtlOpenDevice.dev_idx), unsigned(cached.dev_idx));
+    RtlOpenDevice.dev_idx = cached.dev_idx;
+  }
+
   SDRLG(extHw_MSG_DEBUG, "opening RTL device %u idx %u: %s",
     unsigned(RtlOpenDevice.dev_idx), unsigned(RtlSelectedDeviceIdx), RtlOpenDevice.name);
+  std::unique_lock<std::mutex> enum_lock(enumerate_mutex);
   int r = rtlsdr_open(&RtlSdrDev, RtlOpenDevice.dev_idx);
   if (r < 0)
   {
+    enum_lock.unlock();
     SDRLG(extHw_MSG_ERROR, "opening RTL device failed: %d", r);
     RtlOpenDevice.clear();
     return false;
   }
+  enum_open_device = RtlOpenDevice;
+  enum_lock.unlock();
   SDRLG(extHw_MSG_DEBUG, "open_selected_rtl_device() -> handle 0x%p", RtlSdrDev);
+  shadow_ppm = 0;
 
   rtlsdr_tuner t = rtlsdr_get_tuner_type(RtlSdrDev);
   if (tunerNo < tuners::N)
@@ -272,71 +586,134 @@ bool open_selected_rtl_device()
     SDRLG(extHw_MSG_ERROR, "opened RTL device has unknown tuner type %u", unsigned(t));
 
   tunerNo = uint32_t(t);
+  RtlOpenTunerType = uint32_t(t);
   GotTunerInfo = true;
 
-  // update bandwidths
-  bandwidths = tuners::bws[tunerNo].bw;
-  n_bandwidths = tuners::bws[tunerNo].num;
-  if (n_bandwidths)
-  {
-    int bwIdx = nearestBwIdx(nxt.tuner_bw);
-    nxt.tuner_bw = bandwidths[bwIdx];
-    last.tuner_bw = nxt.tuner_bw + 1;
-  }
+  // tuner type from a previous session confirmed?
+  uint32_t cached_tuner;
+  const bool cache_hit = tuner_cache_lookup(RtlOpenDevice, cached_tuner);
+  if (cache_hit && cached_tuner != tunerNo)
+    SDRLG(extHw_MSG_WARNING, "tuner cache: '%s' had tuner type %u - probed %u", RtlOpenDevice.name, unsigned(cached_tuner), unsigned(tunerNo.load()));
+  if (!cache_hit || cached_tuner != tunerNo)
+    tuner_cache_store(RtlOpenDevice, tunerNo);
 
-  // update hf gains
-  rf_gains = tuners::rf_gains[tunerNo].gain;
-  n_rf_gains = tuners::rf_gains[tunerNo].num;
-  if (n_rf_gains)
-  {
-    int gainIdx = nearestGainIdx(nxt.rf_gain, rf_gains, n_rf_gains);
-    nxt.rf_gain = rf_gains[gainIdx];
-    last.rf_gain = nxt.rf_gain + 10;
-  }
-
-  // update if gains
-  if_gains = tuners::if_gains[tunerNo].gain;
-  n_if_gains = tuners::if_gains[tunerNo].num;
-  if (n_if_gains)
-  {
-    nxt.if_gain_idx = nearestGainIdx(nxt.if_gain_val, if_gains, n_if_gains);
-    nxt.if_gain_val = if_gains[nxt.if_gain_idx];
-    last.if_gain_val = nxt.if_gain_val + 10;
-    last.if_gain_idx = nxt.if_gain_idx + 1;
-  }
+  update_tuner_tables();
 
+  // fresh device: command all groups
   commandEverything.store(true);
   Control_Changes();
   return GotTunerInfo;
 }
 
 
+// requested values of group g equal the applied ones in 'last'? then it needs no command.
+//   only for groups, which are completely described by their values
+static bool is_group_unchanged(const ControlState& n, unsigned g)
+{
+  switch (g)
+  {
+  case CtrlGroup::srate:          return n.srate_idx == last.srate_idx.load();
+  case CtrlGroup::tuner_bw:       return n.tuner_bw == last.tuner_bw.load();
+  case CtrlGroup::rf_agc:         return n.tuner_rf_agc == last.tuner_rf_agc.load();
+  case CtrlGroup::rf_gain:        return n.rf_gain == last.rf_gain.load();
+  case CtrlGroup::if_agc_gain:    return n.tuner_if_agc == last.tuner_if_agc.load() && n.if_gain_idx == last.if_gain_idx.load();
+  case CtrlGroup::rtl_agc:        return n.rtl_agc == last.rtl_agc.load();
+  case CtrlGroup::sampling_mode:  return n.sampling_mode == last.sampling_mode.load();
+  case CtrlGroup::tuner_sideband: return n.USB_sideband == last.USB_sideband.load();
+  default:
+    if (g >= CtrlGroup::gpio0 && g < CtrlGroup::gpio0 + ControlVars::NUM_GPIO_BUTTONS)
+      return n.GPIO[g - CtrlGroup::gpio0] == last.GPIO[g - CtrlGroup::gpio0].load();
+    return false;
+  }
+}
+
+
 bool Control_Changes()
 {
+  std::lock_guard<std::recursive_mutex> lock(control_mutex);
   char acMsg[256];
+  // the standby follows - also when the primary is lost
+  standby_sync();
   rtlsdr_dev_t* dev = RtlSdrDev;
   if (!dev)
     return false;
+  latency::scope total_latency(latency::control_changes);
 
   CtrlFlagT changed = somewhat_changed.exchange(0);
+  // consistent copy of all requested values: e.g. a complete band transition
+  ControlState n;
+  nxt.snapshot(n);
   const bool command_all = commandEverything.exchange(false) || (changed & CtrlFlags::everything);
+  bool transient = false;   // change with PLL or AGC settling
 
-  SDRLG(extHw_MSG_DEBUG, "Control_Changes(): %s changes 0x%x", command_all ? "ALL" : "", unsigned(changed));
-
-  if (last.sampling_mode != nxt.sampling_mode || command_all)
+  // dirty groups: version in nxt differs from the applied one in last.
+  //   versions and values are from the same snapshot
+  uint32_t ver[CtrlGroup::NUM];
+  uint32_t dirty = 0;
+  for (unsigned g = 0; g < CtrlGroup::NUM; ++g)
+  {
+    ver[g] = n.version[g];
+    if (command_all || ver[g] != last.version[g].load())
+      dirty |= (1U << g);
+  }
+  // diff against the applied state: a value changed forth and back - or a band transition
+  //   setting the same values - costs no USB transfer. requires 'last' to match the device
+  if (!command_all && hw_state_valid.load())
+  {
+    for (unsigned g = 0; g < CtrlGroup::NUM; ++g)
+    {
+      if (((dirty >> g) & 1U) && is_group_unchanged(n, g))
+      {
+        dirty &= ~(1U << g);
+        last.version[g].store(ver[g]);
+      }
+    }
+  }
+  // explicit requests to resend, even without value change
+  if (changed & CtrlFlags::freq)
+    dirty |= (1U << CtrlGroup::freq);
+  if (changed & CtrlFlags::rtl_impulse_nc)
+    dirty |= (1U << CtrlGroup::rtl_impulse_nc);
+
+  auto is_dirty = [&dirty](unsigned g) -> bool { return (dirty >> g) & 1U; };
+  auto set_dirty = [&dirty](unsigned g) { dirty |= (1U << g); };
+  auto applied = [&dirty, &ver](unsigned g) {
+    dirty &= ~(1U << g);
+    last.version[g].store(ver[g]);
+  };
+
+  SDRLG(extHw_MSG_DEBUG, "Control_Changes(): %s changes 0x%x, dirty groups 0x%x",
+    command_all ? "ALL" : "", unsigned(changed), unsigned(dirty));
+  if (!dirty)
+    return true;
+
+  // samplerate, the host is receiving - before applying anything
+  const int prev_delivered_srate = delivered_srate(last.sampling_mode, last.srate_idx);
+  bool r2c_switched = false;
+
+  if (is_dirty(CtrlGroup::sampling_mode))
   {
-    int tmp = nxt.sampling_mode;
+    int tmp = n.sampling_mode;
+    const bool prev_r2c = real2cplx_active(last.sampling_mode);
     // printf("set direct sampling %u (=%s)\n", tmp, (!tmp) ? "disabled" : (tmp == 1) ? "pin I-ADC" : (tmp == 2) ? "pin Q-ADC" : "unknown!");
     SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_direct_sampling()");
-    int r = rtlsdr_set_direct_sampling(dev, tmp);
+    int r = LATENCY_TIMED(set_direct_sampling, rtlsdr_set_direct_sampling(dev, tmp));
     if (r < 0)
       SDRLG(extHw_MSG_WARNING, "Error setting rtlsdr_set_direct_sampling(): %d", r);
     last.sampling_mode = tmp;
+    transient = true;
+    applied(CtrlGroup::sampling_mode);
     clear_flag(changed, CtrlFlags::sampling_mode);
+    if (prev_r2c != real2cplx_active(tmp))
+    {
+      // delivered samplerate and hardware center frequency change with real to complex conversion
+      set_dirty(CtrlGroup::freq);
+      r2c_switched = true;
+    }
   }
-  if (last.offset_tuning != nxt.offset_tuning || command_all)
+  if (is_dirty(CtrlGroup::offset_tuning))
   {
-    int tmp = nxt.offset_tuning;
+    int tmp = n.offset_tuning;
     if (isR82XX())
     {
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_offset_tuning(): ignored for tuner");
@@ -344,72 +721,87 @@ bool Control_Changes()
     else
     {
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_offset_tuning()");
-      int r = rtlsdr_set_offset_tuning(dev, tmp);
+      int r = LATENCY_TIMED(set_offset_tuning, rtlsdr_set_offset_tuning(dev, tmp));
       if (r < 0)
         SDRLG(extHw_MSG_WARNING, "Error setting rtlsdr_set_offset_tuning(): %d", r);
     }
     last.offset_tuning = tmp;
+    applied(CtrlGroup::offset_tuning);
     clear_flag(changed, CtrlFlags::offset_tuning);
   }
-  if (last.USB_sideband != nxt.USB_sideband || command_all)
+  if (is_dirty(CtrlGroup::tuner_sideband))
   {
-    int tmp = nxt.USB_sideband.load() ? 1 : 0;
+    int tmp = n.USB_sideband ? 1 : 0;
     // printf("set tuner sideband %d: %s sideband\n", tmp, (tmp ? "upper" : "lower"));
     SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_sideband()");
     int r = -1;
     for (int retry = 0; r < 0 && retry < N_TUNER_RETRIES; ++retry)  // retry!?!?!
-      r = rtlsdr_set_tuner_sideband(dev, tmp);
+      r = LATENCY_TIMED(set_tuner_sideband, rtlsdr_set_tuner_sideband(dev, tmp));
     if (r < 0)
       SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_sideband(): %d", r);
     else
+    {
       last.USB_sideband = tmp;
+      applied(CtrlGroup::tuner_sideband);
+    }
     clear_flag(changed, CtrlFlags::tuner_sideband);
   }
   for (int btnNo = 0; btnNo < NUM_GPIO_BUTTONS; ++btnNo)
   {
-    if (GPIO_en[btnNo] && (last.GPIO[btnNo] != nxt.GPIO[btnNo] || command_all))
+    if (GPIO_en[btnNo] && is_dirty(CtrlGroup::gpio0 + btnNo))
     {
-      int r, tmp = nxt.GPIO[btnNo];
+      int r, tmp = n.GPIO[btnNo];
       const int GPIOpin = GPIO_pin[btnNo];
       const int GPIOval = tmp ^ GPIO_inv[btnNo];
       if (GPIOpin < 0)
       {
         // printf("set bias T %u (%s)\n", tmp, tmp ? "on" : "off");
         SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_bias_tee()");
-        r = rtlsdr_set_bias_tee(dev, GPIOval);  // SET_BIAS_TEE
+        r = LATENCY_TIMED(set_bias_tee, rtlsdr_set_bias_tee(dev, GPIOval));  // SET_BIAS_TEE
       }
       else
       {
         // transmitTcpCmd(conn, GPIO_WRITE_PIN, (GPIOpin << 16) | GPIOval); // GPIO_WRITE_PIN
         // printf("write %d to gpio %d\n", itmp & 0xffff, (itmp >> 16) & 0xffff);
         SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_gpio_output() / rtlsdr_set_gpio_bit()");
-        r = rtlsdr_set_gpio_output(dev, uint8_t(GPIOpin));
-        r = rtlsdr_set_gpio_bit(dev, uint8_t(GPIOpin), GPIOval);
+        r = LATENCY_TIMED(set_gpio, rtlsdr_set_gpio_output(dev, uint8_t(GPIOpin)));
+        r = LATENCY_TIMED(set_gpio, rtlsdr_set_gpio_bit(dev, uint8_t(GPIOpin), GPIOval));
       }
       last.GPIO[btnNo] = tmp;
+      applied(CtrlGroup::gpio0 + btnNo);
     }
+    else if (is_dirty(CtrlGroup::gpio0 + btnNo))
+      applied(CtrlGroup::gpio0 + btnNo);  // disabled button: nothing to command - else dirty forever
     clear_flag(changed, CtrlFlags::gpio);
   }
-  if (last.freq_corr_ppm != nxt.freq_corr_ppm || command_all)
+  if (is_dirty(CtrlGroup::ppm_correction))
   {
-    int tmp = nxt.freq_corr_ppm;
+    int tmp = n.freq_corr_ppm;
     // printf("set freq correction %d ppm\n", itmp);
     SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_freq_correction()");
     int r = 0;
-    int curr_ppm = rtlsdr_get_freq_correction(dev);
+    int curr_ppm = shadow_ppm;
+    if (control_diagnostics.load())
+    {
+      curr_ppm = LATENCY_TIMED(get_freq_correction, rtlsdr_get_freq_correction(dev));
+      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_freq_correction() -> %d, shadow %d", curr_ppm, shadow_ppm);
+    }
     if (curr_ppm != tmp)
     {
-      r = rtlsdr_set_freq_correction(dev, tmp);
+      r = LATENCY_TIMED(set_freq_correction, rtlsdr_set_freq_correction(dev, tmp));
       if (r < 0)
         SDRLG(extHw_MSG_WARNING, "Error setting rtlsdr_set_freq_correction(): %d", r);
+      else
+        shadow_ppm = tmp;
     }
     last.freq_corr_ppm = tmp;
+    applied(CtrlGroup::ppm_correction);
     clear_flag(changed, CtrlFlags::ppm_correction);
   }
-  if (last.band_center_sel != nxt.band_center_sel || command_all)
+  if (is_dirty(CtrlGroup::band_center))
   {
-    int fs = rates::tab[nxt.srate_idx].valueInt;
-    int tmp = nxt.band_center_sel;
+    int fs = rates::tab[n.srate_idx].valueInt;
+    int tmp = n.band_center_sel;
     int band_center = 0;
     if (tmp == 1)
       band_center = fs / 4;
@@ -418,59 +810,74 @@ bool Control_Changes()
 
     // printf("set tuner band to IF frequency %i Hz from center\n", if_band_center_freq);
     SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_band_center()");
-    int r = rtlsdr_set_tuner_band_center(dev, band_center);
+    int r = LATENCY_TIMED(set_tuner_band_center, rtlsdr_set_tuner_band_center(dev, band_center));
     if (r < 0)
       SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_band_center(): %d", r);
     else
     {
       last.band_center_sel = tmp;
-      last.band_center_LO_delta.store(nxt.band_center_LO_delta.load());
+      last.band_center_LO_delta.store(n.band_center_LO_delta);
+      applied(CtrlGroup::band_center);
     }
     clear_flag(changed, CtrlFlags::tuner_band_center);
-    changed |= CtrlFlags::freq;
+    set_dirty(CtrlGroup::freq);
   }
-  const uint64_t f64 = uint64_t(nxt.LO_freq.load());
-  if (last.LO_freq.load() != f64 || (changed & CtrlFlags::freq) || command_all)
+  const uint64_t f64 = uint64_t(n.LO_freq);
+  if (is_dirty(CtrlGroup::freq))
   {
-    int prev_on, prev_counter;
-    rtlsdr_get_impulse_nc(dev, &prev_on, &prev_counter);
-    SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_impulse_nc() -> %d, %d)", prev_on, prev_counter);
+    if (control_diagnostics.load())
+    {
+      int prev_on, prev_counter;
+      LATENCY_TIMED(get_impulse_nc, rtlsdr_get_impulse_nc(dev, &prev_on, &prev_counter));
+      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_impulse_nc() -> %d, %d)", prev_on, prev_counter);
+    }
 
     SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_center_freq64()");
-    int r = rtlsdr_set_center_freq64(dev, f64);
+    int r = LATENCY_TIMED(set_center_freq, rtlsdr_set_center_freq64(dev, hw_center_freq(f64, last.sampling_mode, last.srate_idx)));
     if (r < 0)
       SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_center_freq64(): %d", r);
     else
+    {
       last.LO_freq.store(f64);
+      notch_update_tuning(int64_t(f64), delivered_srate(last.sampling_mode, last.srate_idx));
+      transient = true;
+      applied(CtrlGroup::freq);
+    }
     clear_flag(changed, CtrlFlags::freq);
   }
-  if (last.srate_idx != nxt.srate_idx || command_all)
+  if (is_dirty(CtrlGroup::srate))
   {
     // re-parametrize Tuner RF AGC
     {
-      int tmp = nxt.tuner_rf_agc;
+      int tmp = n.tuner_rf_agc;
       // transmitTcpCmd(conn, SET_GAIN_MODE, 1 - tmp);
       // printf("set gain mode %u (=%s)\n", tmp, tmp ? "manual" : "automatic");
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_gain_mode()");
-      int r = rtlsdr_set_tuner_gain_mode(dev, 1 - tmp);
+      int r = LATENCY_TIMED(set_tuner_gain_mode, rtlsdr_set_tuner_gain_mode(dev, 1 - tmp));
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_gain_mode(): %d", r);
       else
+      {
         last.tuner_rf_agc = tmp;
+        applied(CtrlGroup::rf_agc);
+      }
       clear_flag(changed, CtrlFlags::rf_agc);
     }
 
     // re-parametrize Gain
-    if (nxt.tuner_rf_agc == 0)
+    if (n.tuner_rf_agc == 0)
     {
-      int tmp = nxt.rf_gain;
+      int tmp = n.rf_gain;
       // printf("set manual tuner gain %.1f dB\n", tmp / 10.0);
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_gain()");
-      int r = rtlsdr_set_tuner_gain(dev, tmp);  // SET_GAIN
+      int r = LATENCY_TIMED(set_tuner_gain, rtlsdr_set_tuner_gain(dev, tmp));  // SET_GAIN
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_gain(): %d", r);
       else
+      {
         last.rf_gain = tmp;
+        applied(CtrlGroup::rf_gain);
+      }
       clear_flag(changed, CtrlFlags::rf_gain);
     }
 
@@ -478,64 +885,81 @@ bool Control_Changes()
     if (!isR82XX())
     {
     }
-    else if (nxt.tuner_if_agc)
+    else if (n.tuner_if_agc)
     {
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_if_mode(0)");
-      int r = rtlsdr_set_tuner_if_mode(dev, 0);  // SET_TUNER_IF_MODE; 0 activates AGC
+      int r = LATENCY_TIMED(set_tuner_if_mode, rtlsdr_set_tuner_if_mode(dev, 0));  // SET_TUNER_IF_MODE; 0 activates AGC
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_if_mode(): %d", r);
       else
       {
         last.tuner_if_agc.store(1);
-        last.if_gain_idx.store(nxt.if_gain_idx.load());
+        last.if_gain_idx.store(n.if_gain_idx);
+        applied(CtrlGroup::if_agc_gain);
       }
       clear_flag(changed, CtrlFlags::if_agc_gain);
     }
     else
     {
-      int tmp = nxt.if_gain_idx.load();
+      int tmp = n.if_gain_idx;
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_if_mode(10000+)");
-      int r = rtlsdr_set_tuner_if_mode(dev, 10000 + tmp);  // SET_TUNER_IF_MODE
+      int r = LATENCY_TIMED(set_tuner_if_mode, rtlsdr_set_tuner_if_mode(dev, 10000 + tmp));  // SET_TUNER_IF_MODE
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_if_mode(): %d", r);
       else
       {
         last.tuner_if_agc.store(0);
         last.if_gain_idx.store(tmp);
+        applied(CtrlGroup::if_agc_gain);
       }
       clear_flag(changed, CtrlFlags::if_agc_gain);
     }
 
     // re-parametrize Tuner Bandwidth
     {
-      int tmp = nxt.tuner_bw;
+      int tmp = n.tuner_bw;
       uint32_t applied_bw = 0;
       if (n_bandwidths)
       {
         // SET_TUNER_BANDWIDTH
         SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_and_get_tuner_bandwidth()");
-        rtlsdr_set_and_get_tuner_bandwidth(dev, tmp * 1000, &applied_bw, 1 /* =apply_bw */);
+        LATENCY_TIMED(set_tuner_bandwidth, rtlsdr_set_and_get_tuner_bandwidth(dev, tmp * 1000, &applied_bw, 1 /* =apply_bw */));
       }
       last.tuner_bw = tmp;
+      applied(CtrlGroup::tuner_bw);
       clear_flag(changed, CtrlFlags::tuner_bandwidth);
     }
 
     // re-parametrize samplerate
     {
-      int tmp = nxt.srate_idx;
+      int tmp = n.srate_idx;
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_sample_rate()");
-      int r = rtlsdr_set_sample_rate(dev, rates::tab[tmp].valueInt);  // SET_SAMPLE_RATE
+      int r = LATENCY_TIMED(set_sample_rate, rtlsdr_set_sample_rate(dev, rates::tab[tmp].valueInt));  // SET_SAMPLE_RATE
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_sample_rate(): %d", r);
       else
+      {
         last.srate_idx = tmp;
+        notch_update_tuning(last.LO_freq.load(), delivered_srate(last.sampling_mode, tmp));
+        transient = true;
+        applied(CtrlGroup::srate);
+      }
       clear_flag(changed, CtrlFlags::srate);
+
+      // the fs/4 offset of real to complex conversion depends on the samplerate
+      if (real2cplx_active(last.sampling_mode))
+      {
+        SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_center_freq64() for real to complex conversion");
+        r = LATENCY_TIMED(set_center_freq, rtlsdr_set_center_freq64(dev, hw_center_freq(uint64_t(last.LO_freq.load()), last.sampling_mode, tmp)));
+        if (r < 0)
+          SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_center_freq64(): %d", r);
+      }
     }
 
-    if (last.band_center_sel != nxt.band_center_sel || command_all)
+    if (is_dirty(CtrlGroup::band_center))
     {
-      int tmp_srate_idx = nxt.srate_idx;
-      int tmp_bcsel = nxt.band_center_sel;
+      int tmp_srate_idx = n.srate_idx;
+      int tmp_bcsel = n.band_center_sel;
       int fs = rates::tab[tmp_srate_idx].valueInt;
       int band_center = 0;
       if (tmp_bcsel == 1)
@@ -544,170 +968,190 @@ bool Control_Changes()
         band_center = -fs / 4;
 
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_band_center()");
-      int r = rtlsdr_set_tuner_band_center(dev, band_center);  // SET_TUNER_BW_IF_CENTER
+      int r = LATENCY_TIMED(set_tuner_band_center, rtlsdr_set_tuner_band_center(dev, band_center));  // SET_TUNER_BW_IF_CENTER
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_band_center(): %d", r);
       else
+      {
         last.band_center_sel = tmp_bcsel;
+        applied(CtrlGroup::band_center);
+      }
       clear_flag(changed, CtrlFlags::tuner_band_center);
     }
   }
 
-  if (last.tuner_bw != nxt.tuner_bw)
+  if (is_dirty(CtrlGroup::tuner_bw))
   {
-    //if (!transmitTcpCmd(conn, 0x0E, nxt.tunerBW*1000))
+    //if (!transmitTcpCmd(conn, 0x0E, n.tunerBW*1000))
     //  return false;
-    int tmp = nxt.tuner_bw;
+    int tmp = n.tuner_bw;
     uint32_t applied_bw = 0;  // SET_TUNER_BANDWIDTH
     SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_and_get_tuner_bandwidth()");
     int r = 1;
     for (int retry = 0; r && retry < N_TUNER_RETRIES; ++retry )  // retry!?!?!
-      r = rtlsdr_set_and_get_tuner_bandwidth(dev, tmp * 1000, &applied_bw, 1 /* =apply_bw */);
+      r = LATENCY_TIMED(set_tuner_bandwidth, rtlsdr_set_and_get_tuner_bandwidth(dev, tmp * 1000, &applied_bw, 1 /* =apply_bw */));
     SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_and_get_tuner_bandwidth(%d) -> bw %u, rc %d",
       tmp * 1000, unsigned(applied_bw), r);
     last.tuner_bw = tmp;
+    applied(CtrlGroup::tuner_bw);
     clear_flag(changed, CtrlFlags::tuner_bandwidth);
   }
 
-  if (last.tuner_rf_agc != nxt.tuner_rf_agc)
+  if (is_dirty(CtrlGroup::rf_agc))
   {
-    int tmp = nxt.tuner_rf_agc;
-    int tmp_gain = nxt.rf_gain;
+    int tmp = n.tuner_rf_agc;
+    int tmp_gain = n.rf_gain;
     SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_gain_mode()");
-    int r = rtlsdr_set_tuner_gain_mode(dev, 1 - tmp);
+    int r = LATENCY_TIMED(set_tuner_gain_mode, rtlsdr_set_tuner_gain_mode(dev, 1 - tmp));
     if (r < 0)
       SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_gain_mode(): %d", r);
     else
     {
       last.tuner_rf_agc = tmp;
+      applied(CtrlGroup::rf_agc);
       if (tmp == 0)
-        last.rf_gain = tmp_gain + 1;
+        set_dirty(CtrlGroup::rf_gain);   // manual gain is active again
+      transient = true;
     }
     clear_flag(changed, CtrlFlags::rf_agc);
   }
 
-  if (last.rtl_agc != nxt.rtl_agc || command_all)
+  if (is_dirty(CtrlGroup::rtl_agc))
   {
-    int tmp = nxt.rtl_agc;
+    int tmp = n.rtl_agc;
     // printf("set rtl2832's digital agc mode %d (=%s)\n", tmp, tmp ? "enabled" : "disabled");
     SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_agc_mode()");
-    int r = rtlsdr_set_agc_mode(dev, tmp);  // SET_AGC_MODE
+    int r = LATENCY_TIMED(set_agc_mode, rtlsdr_set_agc_mode(dev, tmp));  // SET_AGC_MODE
     if (r < 0)
       SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_agc_mode(): %d", r);
     else
+    {
       last.rtl_agc = tmp;
+      applied(CtrlGroup::rtl_agc);
+      transient = true;
+    }
     clear_flag(changed, CtrlFlags::rtl_agc);
   }
 
-  if (last.rf_gain != nxt.rf_gain)
+  if (is_dirty(CtrlGroup::rf_gain))
   {
-    int tmp = nxt.rf_gain;
-    if (nxt.tuner_rf_agc == 0)
+    int tmp = n.rf_gain;
+    if (n.tuner_rf_agc == 0)
     {
       // transmit manual gain only when TunerAGC is off
       // printf("set manual tuner gain %.1f dB\n", tmp / 10.0);
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_gain()");
-      int r = rtlsdr_set_tuner_gain(dev, tmp);  // SET_GAIN
+      int r = LATENCY_TIMED(set_tuner_gain, rtlsdr_set_tuner_gain(dev, tmp));  // SET_GAIN
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_gain(): %d", r);
       else
+      {
         last.rf_gain = tmp;
+        applied(CtrlGroup::rf_gain);
+        transient = true;
+      }
     }
+    else
+      applied(CtrlGroup::rf_gain);   // sent, when switching to manual
     clear_flag(changed, CtrlFlags::rf_gain);
   }
 
-  if (last.tuner_if_agc != nxt.tuner_if_agc || last.if_gain_idx != nxt.if_gain_idx)
+  if (is_dirty(CtrlGroup::if_agc_gain))
   {
-    int tmp_agc = nxt.tuner_if_agc;
-    int tmp_gain = nxt.if_gain_idx;
+    int tmp_agc = n.tuner_if_agc;
+    int tmp_gain = n.if_gain_idx;
     if (!isR82XX())
     {
-
+      applied(CtrlGroup::if_agc_gain);   // no IF gain control
     }
     else if (tmp_agc)
     {
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_if_mode()");
-      int r = rtlsdr_set_tuner_if_mode(dev, 0);  // SET_TUNER_IF_MODE
+      int r = LATENCY_TIMED(set_tuner_if_mode, rtlsdr_set_tuner_if_mode(dev, 0));  // SET_TUNER_IF_MODE
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_if_mode(): %d", r);
       else
       {
         last.tuner_if_agc.store(tmp_agc);
         last.if_gain_idx.store(tmp_gain);
+        applied(CtrlGroup::if_agc_gain);
+        transient = true;
       }
       clear_flag(changed, CtrlFlags::if_agc_gain);
     }
     else
     {
       SDRLOG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_tuner_if_mode()");
-      int r = rtlsdr_set_tuner_if_mode(dev, 10000 + tmp_gain);  // SET_TUNER_IF_MODE
+      int r = LATENCY_TIMED(set_tuner_if_mode, rtlsdr_set_tuner_if_mode(dev, 10000 + tmp_gain));  // SET_TUNER_IF_MODE
       if (r < 0)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_tuner_if_mode(): %d", r);
       else
       {
         last.tuner_if_agc = tmp_agc;
         last.if_gain_idx = tmp_gain;
+        applied(CtrlGroup::if_agc_gain);
+        transient = true;
       }
       clear_flag(changed, CtrlFlags::if_agc_gain);
     }
   }
 
-  if (last.rtl_impulse_noise_cancellation != nxt.rtl_impulse_noise_cancellation
-    || (changed & CtrlFlags::rtl_impulse_nc) || command_all)
+  if (is_dirty(CtrlGroup::rtl_impulse_nc))
   {
-    int tmp = nxt.rtl_impulse_noise_cancellation;
+    int tmp = n.rtl_impulse_noise_cancellation;
     if (tmp == 0 || tmp == 1)
     {
-      int prev_on, prev_counter;
-      rtlsdr_get_impulse_nc(dev, &prev_on, &prev_counter);
-      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_impulse_nc() -> %d, %d", prev_on, prev_counter);
+      if (control_diagnostics.load())
+      {
+        int prev_on, prev_counter;
+        LATENCY_TIMED(get_impulse_nc, rtlsdr_get_impulse_nc(dev, &prev_on, &prev_counter));
+        SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_impulse_nc() -> %d, %d", prev_on, prev_counter);
+      }
+      else
+        SDRLG(extHw_MSG_DEBUG, "Control_Changes(): impulse_nc shadow -> %d", last.rtl_impulse_noise_cancellation.load());
 
       SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_impulse_nc(%d)", tmp);
-      int r = rtlsdr_set_impulse_nc(dev, tmp, tmp);
+      int r = LATENCY_TIMED(set_impulse_nc, rtlsdr_set_impulse_nc(dev, tmp, tmp));
       if (r)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_impulse_nc(): %d", r);
     }
     last.rtl_impulse_noise_cancellation = tmp;
+    applied(CtrlGroup::rtl_impulse_nc);
     clear_flag(changed, CtrlFlags::rtl_impulse_nc);
   }
 
-  if (
-    last.rtl_aagc_rf_en != nxt.rtl_aagc_rf_en
-    || last.rtl_aagc_rf_inv != nxt.rtl_aagc_rf_inv
-    || last.rtl_aagc_rf_min != nxt.rtl_aagc_rf_min
-    || last.rtl_aagc_rf_max != nxt.rtl_aagc_rf_max
-    || last.rtl_aagc_if_en != nxt.rtl_aagc_if_en
-    || last.rtl_aagc_if_inv != nxt.rtl_aagc_if_inv
-    || last.rtl_aagc_if_min != nxt.rtl_aagc_if_min
-    || last.rtl_aagc_if_max != nxt.rtl_aagc_if_max
-    || last.rtl_aagc_lg_lock != nxt.rtl_aagc_lg_lock
-    || last.rtl_aagc_lg_unlock != nxt.rtl_aagc_lg_unlock
-    || last.rtl_aagc_lg_ifr != nxt.rtl_aagc_lg_ifr
-    || command_all)
-  {
-    unsigned tRfEn = nxt.rtl_aagc_rf_en;
-    unsigned tRfInv = nxt.rtl_aagc_rf_inv;
-    unsigned tRfMin = nxt.rtl_aagc_rf_min;
-    unsigned tRfMax = nxt.rtl_aagc_rf_max;
-    unsigned tIfEn = nxt.rtl_aagc_if_en;
-    unsigned tIfInv = nxt.rtl_aagc_if_inv;
-    unsigned tIfMin = nxt.rtl_aagc_if_min;
-    unsigned tIfMax = nxt.rtl_aagc_if_max;
-    unsigned tLGLck = nxt.rtl_aagc_lg_lock;
-    unsigned tLGUck = nxt.rtl_aagc_lg_unlock;
-    unsigned tLGIfr = nxt.rtl_aagc_lg_ifr;
-    {
-      int prev_en_rf, prev_inv_rf, prev_rf_min, prev_rf_max;
-      int prev_en_if, prev_inv_if, prev_if_min, prev_if_max;
-      int prev_gain_lock, prev_gain_unlock, prev_gain_interference;
-      rtlsdr_get_aagc(dev,
-        &prev_en_rf, &prev_inv_rf, &prev_rf_min, &prev_rf_max,
-        &prev_en_if, &prev_inv_if, &prev_if_min, &prev_if_max,
-        &prev_gain_lock, &prev_gain_unlock, &prev_gain_interference);
-      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_aagc()\n"
+  if (is_dirty(CtrlGroup::rtl_aagc))
+  {
+    unsigned tRfEn = n.rtl_aagc_rf_en;
+    unsigned tRfInv = n.rtl_aagc_rf_inv;
+    unsigned tRfMin = n.rtl_aagc_rf_min;
+    unsigned tRfMax = n.rtl_aagc_rf_max;
+    unsigned tIfEn = n.rtl_aagc_if_en;
+    unsigned tIfInv = n.rtl_aagc_if_inv;
+    unsigned tIfMin = n.rtl_aagc_if_min;
+    unsigned tIfMax = n.rtl_aagc_if_max;
+    unsigned tLGLck = n.rtl_aagc_lg_lock;
+    unsigned tLGUck = n.rtl_aagc_lg_unlock;
+    unsigned tLGIfr = n.rtl_aagc_lg_ifr;
+    {
+      // shadow: last written values - or read back in diagnostic mode
+      int prev_en_rf = last.rtl_aagc_rf_en, prev_inv_rf = last.rtl_aagc_rf_inv;
+      int prev_rf_min = last.rtl_aagc_rf_min, prev_rf_max = last.rtl_aagc_rf_max;
+      int prev_en_if = last.rtl_aagc_if_en, prev_inv_if = last.rtl_aagc_if_inv;
+      int prev_if_min = last.rtl_aagc_if_min, prev_if_max = last.rtl_aagc_if_max;
+      int prev_gain_lock = last.rtl_aagc_lg_lock, prev_gain_unlock = last.rtl_aagc_lg_unlock;
+      int prev_gain_interference = last.rtl_aagc_lg_ifr;
+      const bool diag = (control_diagnostics.load() != 0);
+      if (diag)
+        LATENCY_TIMED(get_aagc, rtlsdr_get_aagc(dev,
+          &prev_en_rf, &prev_inv_rf, &prev_rf_min, &prev_rf_max,
+          &prev_en_if, &prev_inv_if, &prev_if_min, &prev_if_max,
+          &prev_gain_lock, &prev_gain_unlock, &prev_gain_interference));
+      SDRLG(extHw_MSG_DEBUG, "Control_Changes(): %s\n"
         "  -> RF: en %d, inv %d, %d - %d\n"
         "  -> IF: en %d, inv %d, %d - %d\n"
         "  -> loop: lock %d, unlock %d, interference %d",
+        diag ? "rtlsdr_get_aagc()" : "aagc shadow",
         prev_en_rf, prev_inv_rf, prev_rf_min, prev_rf_max,
         prev_en_if, prev_inv_if, prev_if_min, prev_if_max,
         prev_gain_lock, prev_gain_unlock, prev_gain_interference);
@@ -719,10 +1163,10 @@ bool Control_Changes()
         tRfEn, tRfInv, tRfMin, tRfMax,
         tIfEn, tIfInv, tIfMin, tIfMax,
         tLGLck, tLGUck, tLGIfr);
-      int r = rtlsdr_set_aagc(dev,
+      int r = LATENCY_TIMED(set_aagc, rtlsdr_set_aagc(dev,
         tRfEn, tRfInv, tRfMin, tRfMax,
         tIfEn, tIfInv, tIfMin, tIfMax,
-        tLGLck, tLGUck, tLGIfr);
+        tLGLck, tLGUck, tLGIfr));
       if (r)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_aagc(): %d", r);
     }
@@ -737,30 +1181,28 @@ bool Control_Changes()
     if (tLGLck < 32U)   last.rtl_aagc_lg_lock = tLGLck;
     if (tLGUck < 32U)   last.rtl_aagc_lg_unlock = tLGUck;
     if (tLGIfr < 32U)   last.rtl_aagc_lg_ifr  = tLGIfr;
+    applied(CtrlGroup::rtl_aagc);
   }
 
-  if (last.rtl_aagc_vtop[0] != nxt.rtl_aagc_vtop[0]
-    || last.rtl_aagc_vtop[1] != nxt.rtl_aagc_vtop[1]
-    || last.rtl_aagc_vtop[2] != nxt.rtl_aagc_vtop[2]
-    || last.rtl_aagc_krf[0] != nxt.rtl_aagc_krf[0]
-    || last.rtl_aagc_krf[1] != nxt.rtl_aagc_krf[1]
-    || last.rtl_aagc_krf[2] != nxt.rtl_aagc_krf[2]
-    || last.rtl_aagc_krf[3] != nxt.rtl_aagc_krf[3]
-    || command_all)
+  if (is_dirty(CtrlGroup::rtl_aagc_distrib))
   {
-    int vtop[3] = { nxt.rtl_aagc_vtop[0], nxt.rtl_aagc_vtop[1], nxt.rtl_aagc_vtop[2] };
-    int krf[4] = { nxt.rtl_aagc_krf[0], nxt.rtl_aagc_krf[1], nxt.rtl_aagc_krf[2], nxt.rtl_aagc_krf[3] };
-
-    int prev_vtop[3], prev_krf[4];
-    rtlsdr_get_aagc_gain_distrib(dev, prev_vtop, prev_krf);
-    SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_get_agc_gain_distrib() -> vtop[]: %d, %d, %d  krf[]: %d, %d, %d, %d",
+    int vtop[3] = { n.rtl_aagc_vtop[0], n.rtl_aagc_vtop[1], n.rtl_aagc_vtop[2] };
+    int krf[4] = { n.rtl_aagc_krf[0], n.rtl_aagc_krf[1], n.rtl_aagc_krf[2], n.rtl_aagc_krf[3] };
+
+    int prev_vtop[3] = { last.rtl_aagc_vtop[0], last.rtl_aagc_vtop[1], last.rtl_aagc_vtop[2] };
+    int prev_krf[4] = { last.rtl_aagc_krf[0], last.rtl_aagc_krf[1], last.rtl_aagc_krf[2], last.rtl_aagc_krf[3] };
+    const bool diag = (control_diagnostics.load() != 0);
+    if (diag)
+      LATENCY_TIMED(get_aagc_gain_distrib, rtlsdr_get_aagc_gain_distrib(dev, prev_vtop, prev_krf));
+    SDRLG(extHw_MSG_DEBUG, "Control_Changes(): %s -> vtop[]: %d, %d, %d  krf[]: %d, %d, %d, %d",
+      diag ? "rtlsdr_get_agc_gain_distrib()" : "agc gain distrib shadow",
       prev_vtop[0], prev_vtop[1], prev_vtop[2],
       prev_krf[0], prev_krf[1], prev_krf[2], prev_krf[3]);
 
     SDRLG(extHw_MSG_DEBUG, "Control_Changes(): rtlsdr_set_agc_gain_distrib(vtop[]: %d, %d, %d  krf[]: %d, %d, %d, %d)",
       vtop[0], vtop[1], vtop[2],
       krf[0], krf[1], krf[2], krf[3]);
-      int r = rtlsdr_set_aagc_gain_distrib(dev, vtop, krf);
+      int r = LATENCY_TIMED(set_aagc_gain_distrib, rtlsdr_set_aagc_gain_distrib(dev, vtop, krf));
       if (r)
         SDRLG(extHw_MSG_ERROR, "Error setting rtlsdr_set_agc_gain_distrib(): %d", r);
 
@@ -771,7 +1213,30 @@ bool Control_Changes()
     last.rtl_aagc_krf[1] = krf[1];
     last.rtl_aagc_krf[2] = krf[2];
     last.rtl_aagc_krf[3] = krf[3];
+    applied(CtrlGroup::rtl_aagc_distrib);
+  }
+
+  if (transient)
+    settle_mark_change(tunerNo, rates::tab[last.srate_idx].valueInt);
+
+  // decided on the applied values - not on command_all: a command-all pass at StartHW()
+  //   may enter a band with samplerate or direct sampling, while already streaming
+  if (delivered_srate(last.sampling_mode, last.srate_idx) != prev_delivered_srate)
+  {
+    // while delivering, the RX thread signals at the first block with the new rate.
+    //   else, callers signalled a samplerate change already - but not the real to complex switch
+    if (!rx_mark_srate_change() && r2c_switched && gpfnExtIOCallbackPtr)
+      EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);
+  }
+
+  // groups, which could not be applied, stay dirty for the next pass
+  for (unsigned g = 0; dirty && g < CtrlGroup::NUM; ++g)
+  {
+    if (is_dirty(g))
+      last.version[g].store(ver[g] - 1);
   }
+  if (command_all)
+    hw_state_valid = true;
 
   return true;
 }
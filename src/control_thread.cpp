@@ -0,0 +1,204 @@
+
+#include "control.h"
+#include "mpsc_queue.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <windows.h>
+#include <process.h>
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+#define SDRLG( A, TEXT, ...) do { if ( gpfnExtIOCallbackPtr ) { snprintf(acMsg, 255, TEXT, __VA_ARGS__); gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); } } while (0)
+
+
+// all the control changes (USB control transfers) are executed in this thread,
+//   that the exported ExtIO functions and GUI handlers return immediately
+static MpscQueue<CtrlFlagT, 256> control_queue;
+static std::atomic<CtrlFlagT> control_overflow = 0;   // flags, which didn't fit into the queue
+
+static std::atomic_bool terminate_Control_Thread = false;
+static std::atomic_bool Control_Thread_running = false;
+static volatile HANDLE Control_thread_handle = INVALID_HANDLE_VALUE;
+static HANDLE Control_event = NULL;
+
+std::atomic_int min_retune_interval_ms = 0;
+
+static std::atomic_uint64_t retunes_requested = 0;
+static std::atomic_uint64_t retunes_applied = 0;
+static std::atomic_uint64_t retunes_elided = 0;
+
+static void Control_ThreadProc(void* param);
+
+
+RetuneStats get_retune_stats()
+{
+  RetuneStats s;
+  s.requested = retunes_requested.load();
+  s.applied = retunes_applied.load();
+  s.elided = retunes_elided.load();
+  return s;
+}
+
+
+void trigger_control(CtrlFlagT f)
+{
+  if (f & CtrlFlags::freq)
+    ++retunes_requested;
+
+  if (!Control_Thread_running.load())
+  {
+    // no worker: before OpenHW() or after CloseHW()
+    somewhat_changed.fetch_or(f);
+    Control_Changes();
+    if (f & CtrlFlags::freq)
+      ++retunes_applied;
+    return;
+  }
+
+  if (!control_queue.push(f))
+    control_overflow.fetch_or(f);
+  SetEvent(Control_event);
+}
+
+
+int Start_Control_Thread()
+{
+  //If already running, exit
+  if (Control_thread_handle != INVALID_HANDLE_VALUE)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_Control_Thread(): Error thread still running!");
+    return 0;   // all fine
+  }
+
+  if (!Control_event)
+    Control_event = CreateEvent(NULL, FALSE, FALSE, NULL);  // auto-reset
+  if (!Control_event)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_Control_Thread(): Error at CreateEvent()");
+    return -1;
+  }
+
+  terminate_Control_Thread = false;
+
+  SDRLOG(extHw_MSG_DEBUG, "Starting Control thread ..");
+  Control_thread_handle = (HANDLE)_beginthread(Control_ThreadProc, 0, NULL);
+  if (Control_thread_handle == INVALID_HANDLE_VALUE)
+  {
+    SDRLOG(extHw_MSG_ERROR, "Start_Control_Thread(): Error at _beginthread()");
+    return -1;  // ERROR
+  }
+  Control_Thread_running = true;
+  return 0;
+}
+
+
+int Stop_Control_Thread()
+{
+  char acMsg[256];
+  // from now on, trigger_control() works synchronous
+  Control_Thread_running = false;
+  terminate_Control_Thread = true;
+  SDRLOG(extHw_MSG_DEBUG, "Stopping Control thread  ..");
+  if (Control_thread_handle == INVALID_HANDLE_VALUE)
+    return 0;
+  SetEvent(Control_event);
+  WaitForSingleObject(Control_thread_handle, INFINITE);
+  SDRLOG(extHw_MSG_DEBUG, "Stop_Control_Thread(): thread() stopped successfully");
+  Control_thread_handle = INVALID_HANDLE_VALUE;
+
+  const RetuneStats st = get_retune_stats();
+  SDRLG(extHw_MSG_DEBUG, "retunes: %llu requested, %llu applied, %llu elided",
+    (unsigned long long)st.requested, (unsigned long long)st.applied, (unsigned long long)st.elided);
+  return 0;
+}
+
+
+// collect all queued flags - multiple requests are served with one Control_Changes()
+static CtrlFlagT drain_control_queue(unsigned& n_freq)
+{
+  CtrlFlagT flags = control_overflow.exchange(0);
+  if (flags & CtrlFlags::freq)
+    ++n_freq;   // at least one
+  CtrlFlagT f;
+  while (control_queue.pop(f))
+  {
+    flags |= f;
+    if (f & CtrlFlags::freq)
+      ++n_freq;
+  }
+  return flags;
+}
+
+
+static void apply_changes(CtrlFlagT flags, unsigned& n_freq)
+{
+  somewhat_changed.fetch_or(flags);
+  Control_Changes();
+  if (n_freq)
+  {
+    ++retunes_applied;
+    retunes_elided += n_freq - 1;
+    n_freq = 0;
+  }
+}
+
+
+static void Control_ThreadProc(void* param)
+{
+  using clock = std::chrono::steady_clock;
+  SDRLOG(extHw_MSG_DEBUG, "Control_ThreadProc() started");
+
+  CtrlFlagT held = 0;       // flags, waiting for the min retune interval
+  unsigned n_freq = 0;      // frequency requests in held
+  clock::time_point last_retune = clock::now() - std::chrono::hours(1);
+  DWORD wait_ms = INFINITE;
+
+  while (!terminate_Control_Thread.load())
+  {
+    WaitForSingleObject(Control_event, wait_ms);
+    wait_ms = INFINITE;
+    const CtrlFlagT flags = held | drain_control_queue(n_freq);
+    held = 0;
+    if (!flags)
+      continue;
+
+    if (n_freq)
+    {
+      // too early for the next retune? keep everything and wait for more
+      //   Control_Changes() would also tune the new LO along with other changes
+      const int min_ms = min_retune_interval_ms.load();
+      const auto since = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - last_retune).count();
+      if (min_ms > 0 && since < min_ms)
+      {
+        held = flags;
+        wait_ms = DWORD(min_ms - since);
+        continue;
+      }
+      last_retune = clock::now();
+    }
+    apply_changes(flags, n_freq);
+  }
+
+  // apply what's left - synchronous trigger_control() takes over
+  const CtrlFlagT flags = held | drain_control_queue(n_freq);
+  if (flags)
+    apply_changes(flags, n_freq);
+
+  Control_thread_handle = INVALID_HANDLE_VALUE;
+  SDRLOG(extHw_MSG_DEBUG, "Control_ThreadProc() finished. Finishing thread.");
+  _endthread();
+}
@@ -0,0 +1,283 @@
+
+#include "fastconv.h"
+
+#include <cmath>
+#include <cstring>
+
+static const double PI = 3.14159265358979323846;
+
+
+FastConv::FastConv()
+  : max_taps(0)
+  , block_len(0)
+  , tb_back(0)
+  , tb_front(1)
+  , tb_middle(2)
+  , in_re(nullptr)
+  , in_im(nullptr)
+  , work_re(nullptr)
+  , work_im(nullptr)
+  , fill(0)
+  , shift_norm(0.0)
+  , osc_re(1.0)
+  , osc_im(0.0)
+  , decim(1)
+  , decim_phase(0)
+{
+  for (int k = 0; k < 3; ++k)
+    spec_re[k] = spec_im[k] = nullptr;
+}
+
+FastConv::~FastConv()
+{
+  release();
+}
+
+void FastConv::release()
+{
+  for (int k = 0; k < 3; ++k)
+  {
+    free_aligned_floats(spec_re[k]);
+    free_aligned_floats(spec_im[k]);
+    spec_re[k] = spec_im[k] = nullptr;
+  }
+  free_aligned_floats(in_re);
+  free_aligned_floats(in_im);
+  free_aligned_floats(work_re);
+  free_aligned_floats(work_im);
+  in_re = in_im = work_re = work_im = nullptr;
+  fft.release();
+  max_taps = block_len = 0;
+}
+
+bool FastConv::init(unsigned fft_len, unsigned n_max_taps)
+{
+  release();
+  if (n_max_taps < 1 || n_max_taps >= fft_len || !fft.init(fft_len))
+    return false;
+
+  max_taps = n_max_taps;
+  block_len = fft_len - max_taps + 1;
+  bool ok = true;
+  for (int k = 0; k < 3; ++k)
+  {
+    spec_re[k] = alloc_aligned_floats(fft_len);
+    spec_im[k] = alloc_aligned_floats(fft_len);
+    ok = ok && spec_re[k] && spec_im[k];
+  }
+  in_re = alloc_aligned_floats(fft_len);
+  in_im = alloc_aligned_floats(fft_len);
+  work_re = alloc_aligned_floats(fft_len);
+  work_im = alloc_aligned_floats(fft_len);
+  ok = ok && in_re && in_im && work_re && work_im;
+  if (!ok)
+  {
+    release();
+    return false;
+  }
+
+  // start with a pass through filter: a single unity tap
+  tb_back = 0;
+  tb_front = 1;
+  tb_middle = 2;
+  const float one = 1.0F;
+  set_filter(&one, nullptr, 1);
+  tb_front = tb_middle.exchange(tb_front) & 3;
+  reset();
+  return true;
+}
+
+void FastConv::reset()
+{
+  const unsigned n = fft.length();
+  for (unsigned k = 0; k < n; ++k)
+    in_re[k] = in_im[k] = 0.0F;
+  fill = max_taps - 1;    // the history: max_taps - 1 zeros
+  osc_re = 1.0;
+  osc_im = 0.0;
+  decim_phase = 0;
+}
+
+void FastConv::publish_spectrum()
+{
+  tb_back = tb_middle.exchange(tb_back | TB_DIRTY) & 3;
+}
+
+bool FastConv::set_filter(const float* taps_re, const float* taps_im, unsigned n_taps)
+{
+  const unsigned n = fft.length();
+  if (!n || !taps_re || n_taps < 1 || n_taps > max_taps)
+    return false;
+
+  float* re = back_spec_re();
+  float* im = back_spec_im();
+  const float scale = 1.0F / float(n);   // compensates the unscaled inverse FFT
+  for (unsigned k = 0; k < n; ++k)
+  {
+    re[k] = (k < n_taps) ? taps_re[k] * scale : 0.0F;
+    im[k] = (k < n_taps && taps_im) ? taps_im[k] * scale : 0.0F;
+  }
+  fft.forward(re, im);
+  publish_spectrum();
+  return true;
+}
+
+bool FastConv::set_spectrum(const float* H_re, const float* H_im)
+{
+  const unsigned n = fft.length();
+  if (!n || !H_re || !H_im)
+    return false;
+
+  float* re = back_spec_re();
+  float* im = back_spec_im();
+  const float scale = 1.0F / float(n);
+  for (unsigned k = 0; k < n; ++k)
+  {
+    re[k] = H_re[k] * scale;
+    im[k] = H_im[k] * scale;
+  }
+  publish_spectrum();
+  return true;
+}
+
+void FastConv::set_shift(double f_norm)
+{
+  shift_norm.store(f_norm);
+}
+
+void FastConv::set_decimation(unsigned d)
+{
+  decim.store(d ? d : 1);
+}
+
+int FastConv::max_output(int n_pairs) const
+{
+  if (!block_len)
+    return 0;
+  // complete blocks, which can get ready - before decimation
+  const unsigned pending = fill - (max_taps - 1) + unsigned(n_pairs);
+  return int(pending / block_len + 1) * int(block_len);
+}
+
+void FastConv::run_block(float* out_iq, int& n_out)
+{
+  if (tb_middle.load(std::memory_order_acquire) & TB_DIRTY)
+    tb_front = tb_middle.exchange(tb_front) & 3;
+
+  const unsigned n = fft.length();
+  memcpy(work_re, in_re, n * sizeof(float));
+  memcpy(work_im, in_im, n * sizeof(float));
+  fft.forward(work_re, work_im);
+
+  const float* h_re = spec_re[tb_front];
+  const float* h_im = spec_im[tb_front];
+  for (unsigned k = 0; k < n; ++k)
+  {
+    const float r = work_re[k] * h_re[k] - work_im[k] * h_im[k];
+    const float i = work_re[k] * h_im[k] + work_im[k] * h_re[k];
+    work_re[k] = r;
+    work_im[k] = i;
+  }
+  fft.inverse(work_re, work_im);
+
+  // the first (max_taps - 1) outputs are aliased: discard. keep every d'th of the rest
+  const unsigned d = decim.load(std::memory_order_relaxed);
+  unsigned k = max_taps - 1 + decim_phase;
+  for (; k < n; k += d)
+  {
+    out_iq[2 * n_out] = work_re[k];
+    out_iq[2 * n_out + 1] = work_im[k];
+    ++n_out;
+  }
+  decim_phase = k - n;
+
+  // keep the history for the next block
+  memmove(in_re, in_re + block_len, (max_taps - 1) * sizeof(float));
+  memmove(in_im, in_im + block_len, (max_taps - 1) * sizeof(float));
+  fill = max_taps - 1;
+}
+
+int FastConv::process(const float* in_iq, int n_pairs, float* out_iq)
+{
+  if (!block_len)
+    return 0;
+
+  const double f = shift_norm.load(std::memory_order_relaxed);
+  const bool mix = (f != 0.0);
+  double step_re = 1.0, step_im = 0.0;
+  if (mix)
+  {
+    step_re = std::cos(-2.0 * PI * f);
+    step_im = std::sin(-2.0 * PI * f);
+  }
+
+  const unsigned n = fft.length();
+  int n_out = 0;
+  int i = 0;
+  while (i < n_pairs)
+  {
+    unsigned todo = n - fill;
+    if (todo > unsigned(n_pairs - i))
+      todo = unsigned(n_pairs - i);
+    float* dst_re = in_re + fill;
+    float* dst_im = in_im + fill;
+    const float* src = in_iq + 2 * i;
+    if (!mix)
+    {
+      for (unsigned k = 0; k < todo; ++k)
+      {
+        dst_re[k] = src[2 * k];
+        dst_im[k] = src[2 * k + 1];
+      }
+    }
+    else
+    {
+      for (unsigned k = 0; k < todo; ++k)
+      {
+        const double xr = src[2 * k];
+        const double xi = src[2 * k + 1];
+        dst_re[k] = float(xr * osc_re - xi * osc_im);
+        dst_im[k] = float(xr * osc_im + xi * osc_re);
+        const double t = osc_re * step_re - osc_im * step_im;
+        osc_im = osc_re * step_im + osc_im * step_re;
+        osc_re = t;
+      }
+    }
+    fill += todo;
+    i += int(todo);
+    if (fill == n)
+      run_block(out_iq, n_out);
+  }
+
+  if (mix)
+  {
+    // renormalize oscillator amplitude against accumulating rounding errors
+    const double mag = std::sqrt(osc_re * osc_re + osc_im * osc_im);
+    osc_re /= mag;
+    osc_im /= mag;
+  }
+  return n_out;
+}
+
+void FastConv::design_lowpass(float* taps, unsigned n_taps, double cutoff_norm)
+{
+  if (!taps || !n_taps)
+    return;
+  const double mid = 0.5 * double(n_taps - 1);
+  double sum = 0.0;
+  for (unsigned k = 0; k < n_taps; ++k)
+  {
+    const double t = double(k) - mid;
+    const double sinc = (t == 0.0) ? 2.0 * cutoff_norm
+      : std::sin(2.0 * PI * cutoff_norm * t) / (PI * t);
+    const double w = (n_taps == 1) ? 1.0
+      : 0.42 - 0.5 * std::cos(2.0 * PI * k / (n_taps - 1)) + 0.08 * std::cos(4.0 * PI * k / (n_taps - 1));
+    taps[k] = float(sinc * w);
+    sum += sinc * w;
+  }
+  if (sum != 0.0)
+  {
+    for (unsigned k = 0; k < n_taps; ++k)
+      taps[k] = float(taps[k] / sum);
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "fft.h"
+
+#include <atomic>
+
+// overlap-save fast convolution engine for long complex FIR filters.
+//
+// fft length and the maximum number of taps are fixed at init(): each FFT block then
+//   consumes (fft_len - max_taps + 1) new samples. the cost per sample only depends on
+//   fft_len - not on the number of taps.
+// usable for decimation (set_decimation), channel selection (set_shift + lowpass)
+//   and equalisation (set_spectrum).
+//
+// threading: init()/release() while not processing. set_filter(), set_spectrum(),
+//   set_shift() and set_decimation() may be called from one control thread while another
+//   thread is in process(). new filter spectra are handed over with a lock free
+//   triple buffer - and are activated at the next FFT block.
+
+struct FastConv
+{
+  FastConv();
+  ~FastConv();
+
+  bool init(unsigned fft_len, unsigned max_taps);   // allocates!
+  void release();
+  void reset();   // clear history and pending output phase
+
+  unsigned fft_length() const { return fft.length(); }
+  unsigned block_length() const { return block_len; }   // new samples per FFT block
+
+  // control path: precompute the spectrum of new taps. no allocation
+  //   taps_im may be nullptr for real taps
+  bool set_filter(const float* taps_re, const float* taps_im, unsigned n_taps);
+  // control path: set fft_len spectrum bins directly - e.g. for an equaliser
+  bool set_spectrum(const float* H_re, const float* H_im);
+  // mix input with exp(-j 2 pi f_norm n) before filtering: f_norm = frequency / samplerate
+  void set_shift(double f_norm);
+  // keep only every d'th output sample
+  void set_decimation(unsigned d);
+
+  // process interleaved I/Q float samples. out must have space for
+  //   max_output(n_pairs) I/Q pairs. returns the number of produced I/Q pairs.
+  int process(const float* in_iq, int n_pairs, float* out_iq);
+  int max_output(int n_pairs) const;
+
+  // windowed sinc lowpass (Blackman) with unity gain at DC. cutoff_norm = cutoff / samplerate
+  static void design_lowpass(float* taps, unsigned n_taps, double cutoff_norm);
+
+private:
+  FastConv(const FastConv&) = delete;
+  FastConv& operator=(const FastConv&) = delete;
+
+  static constexpr int TB_DIRTY = 4;
+
+  void run_block(float* out_iq, int& n_out);
+  float* back_spec_re() { return spec_re[tb_back]; }
+  float* back_spec_im() { return spec_im[tb_back]; }
+  void publish_spectrum();
+
+  FFT fft;
+  unsigned max_taps;
+  unsigned block_len;
+
+  // filter spectra: triple buffer - writer owns tb_back, reader owns tb_front
+  float* spec_re[3];
+  float* spec_im[3];
+  int tb_back;
+  int tb_front;
+  std::atomic_int tb_middle;  // index | TB_DIRTY
+
+  // input history and work buffers
+  float* in_re;
+  float* in_im;
+  float* work_re;
+  float* work_im;
+  unsigned fill;
+
+  std::atomic<double> shift_norm;
+  double osc_re, osc_im;    // mixer oscillator state
+
+  std::atomic_uint decim;
+  unsigned decim_phase;
+};
@@ -0,0 +1,155 @@
+
+#include "fft.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+static constexpr size_t DSP_ALIGNMENT = 64;   // cache line - and enough for AVX-512
+
+
+float* alloc_aligned_floats(size_t n)
+{
+  const size_t bytes = ((n * sizeof(float) + DSP_ALIGNMENT - 1) / DSP_ALIGNMENT) * DSP_ALIGNMENT;
+#ifdef _MSC_VER
+  float* p = (float*)_aligned_malloc(bytes, DSP_ALIGNMENT);
+#else
+  float* p = (float*)std::aligned_alloc(DSP_ALIGNMENT, bytes);
+#endif
+  if (p)
+  {
+    for (size_t k = 0; k < bytes / sizeof(float); ++k)
+      p[k] = 0.0F;
+  }
+  return p;
+}
+
+void free_aligned_floats(float* p)
+{
+  if (!p)
+    return;
+#ifdef _MSC_VER
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+
+FFT::FFT()
+  : len(0)
+  , bitrev(nullptr)
+  , tw_re(nullptr)
+  , tw_im_fwd(nullptr)
+  , tw_im_inv(nullptr)
+{
+}
+
+FFT::~FFT()
+{
+  release();
+}
+
+void FFT::release()
+{
+  delete[] bitrev;
+  free_aligned_floats(tw_re);
+  free_aligned_floats(tw_im_fwd);
+  free_aligned_floats(tw_im_inv);
+  bitrev = nullptr;
+  tw_re = tw_im_fwd = tw_im_inv = nullptr;
+  len = 0;
+}
+
+bool FFT::init(unsigned n)
+{
+  if (n < MIN_LEN || n > MAX_LEN || (n & (n - 1)))
+    return false;
+  if (n == len)
+    return true;
+
+  release();
+  bitrev = new (std::nothrow) unsigned[n];
+  tw_re = alloc_aligned_floats(n / 2);
+  tw_im_fwd = alloc_aligned_floats(n / 2);
+  tw_im_inv = alloc_aligned_floats(n / 2);
+  if (!bitrev || !tw_re || !tw_im_fwd || !tw_im_inv)
+  {
+    release();
+    return false;
+  }
+
+  unsigned bits = 0;
+  while ((1U << bits) < n)
+    ++bits;
+  for (unsigned k = 0; k < n; ++k)
+  {
+    unsigned r = 0;
+    for (unsigned b = 0; b < bits; ++b)
+      r |= ((k >> b) & 1U) << (bits - 1 - b);
+    bitrev[k] = r;
+  }
+
+  const double pi = 3.14159265358979323846;
+  for (unsigned k = 0; k < n / 2; ++k)
+  {
+    const double w = 2.0 * pi * double(k) / double(n);
+    tw_re[k] = float(std::cos(w));
+    tw_im_fwd[k] = float(-std::sin(w));
+    tw_im_inv[k] = float(std::sin(w));
+  }
+  len = n;
+  return true;
+}
+
+void FFT::forward(float* re, float* im) const
+{
+  transform(re, im, tw_im_fwd);
+}
+
+void FFT::inverse(float* re, float* im) const
+{
+  transform(re, im, tw_im_inv);
+}
+
+void FFT::transform(float* re, float* im, const float* tw_im) const
+{
+  const unsigned n = len;
+  for (unsigned k = 0; k < n; ++k)
+  {
+    const unsigned r = bitrev[k];
+    if (r > k)
+    {
+      float t = re[k]; re[k] = re[r]; re[r] = t;
+      t = im[k]; im[k] = im[r]; im[r] = t;
+    }
+  }
+
+  // iterative decimation in time. inner loop over j is contiguous - vectorizes
+  for (unsigned half = 1; half < n; half <<= 1)
+  {
+    const unsigned tw_step = n / (2 * half);
+    for (unsigned start = 0; start < n; start += 2 * half)
+    {
+      float* ar = re + start;
+      float* ai = im + start;
+      float* br = ar + half;
+      float* bi = ai + half;
+      for (unsigned j = 0; j < half; ++j)
+      {
+        const float wr = tw_re[j * tw_step];
+        const float wi = tw_im[j * tw_step];
+        const float tr = br[j] * wr - bi[j] * wi;
+        const float ti = br[j] * wi + bi[j] * wr;
+        br[j] = ar[j] - tr;
+        bi[j] = ai[j] - ti;
+        ar[j] += tr;
+        ai[j] += ti;
+      }
+    }
+  }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+
+// aligned float buffers for the DSP stages - SIMD friendly, never allocated on the hot path
+float* alloc_aligned_floats(size_t n);
+void free_aligned_floats(float* p);
+
+
+// complex radix-2 FFT with fixed (power of 2) length, precomputed twiddles and bit reversal.
+// data is in split format: separate arrays for real and imaginary parts.
+// the inverse transform is NOT scaled by 1/N
+struct FFT
+{
+  static constexpr unsigned MIN_LEN = 16;
+  static constexpr unsigned MAX_LEN = 1U << 20;
+
+  FFT();
+  ~FFT();
+
+  bool init(unsigned len);  // allocates! len must be a power of 2
+  void release();
+
+  unsigned length() const { return len; }
+
+  void forward(float* re, float* im) const;
+  void inverse(float* re, float* im) const;
+
+private:
+  FFT(const FFT&) = delete;
+  FFT& operator=(const FFT&) = delete;
+
+  void transform(float* re, float* im, const float* tw_im) const;
+
+  unsigned len;
+  unsigned* bitrev;
+  float* tw_re;     // cos(2 pi k / len)
+  float* tw_im_fwd; // -sin(2 pi k / len)
+  float* tw_im_inv; // +sin(2 pi k / len)
+};
@@ -18,6 +18,7 @@
 #include "tuners.h"
 #include "rates.h"
 #include "control.h"
+#include "latency.h"
 #include "resource.h"
 
 #include "LC_ExtIO_Types.h"
@@ -83,6 +84,7 @@ extern std::atomic_bool retune_freq;
 
 int nearestBwIdx(int bw);
 int nearestGainIdx(int gain, const int* gains, const int n_gains);
+int Stop_RX_Thread();
 
 static int maxDecimation = 0;
 
@@ -108,6 +110,10 @@ static HWND h_dlg = NULL;
 char band_disp_text[255] = { 0 };
 std::atomic_bool update_band_text = false;
 
+// OpenHW() until the GUI shows the controls of the known tuner - cached or probed
+static std::chrono::steady_clock::time_point gui_ready_t0;
+static std::atomic_bool gui_ready_pending = false;
+
 
 static inline bool isR82XX()
 {
@@ -160,6 +166,25 @@ void post_update_gui_init()
 #endif
 }
 
+void gui_measure_ready(std::chrono::steady_clock::time_point t0)
+{
+  gui_ready_t0 = t0;
+  gui_ready_pending = true;
+}
+
+#ifdef HAS_WIN_GUI_DLG
+static void check_gui_ready()
+{
+  if (tunerNo == RTLSDR_TUNER_UNKNOWN || !gui_ready_pending.exchange(false))
+    return;
+  char acMsg[256];
+  const auto dt = std::chrono::steady_clock::now() - gui_ready_t0;
+  const uint64_t us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(dt).count());
+  latency::record(latency::open_to_gui_ready, us);
+  SDRLG(extHw_MSG_DEBUG, "OpenHW() to GUI ready: %u ms", unsigned(us / 1000));
+}
+#endif
+
 void post_update_gui_fields()
 {
 #ifdef HAS_WIN_GUI_DLG
@@ -601,6 +626,7 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
     updateIFTunerGains(h_dlg);
     updateGPIOs(h_dlg);
     updateDeviceList(h_dlg);
+    check_gui_ready();
 
     return TRUE;
   }
@@ -650,6 +676,7 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
       const bool upd_band_text = update_band_text.exchange(false);
       if (upd_band_text)
         Static_SetText(hDlgItmBandText, band_disp_text);
+      check_gui_ready();
     }
     return TRUE;
 
@@ -756,8 +783,6 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
       else if (Button_GetCheck(GET_WM_COMMAND_HWND(wParam, lParam)) == BST_CHECKED) //it is checked
       {
         nxt.tuner_if_agc = 1; // automatic
-        last.if_gain_val = nxt.if_gain_val + 1;
-        last.if_gain_idx = nxt.if_gain_idx + 1;
         trigger_control(CtrlFlags::if_agc_gain);
         EnableWindow(hIFGain, FALSE);
         Static_SetText(hIFGainLabel, TEXT("IF AGC"));
@@ -765,8 +790,6 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
       else //it has been unchecked
       {
         nxt.tuner_if_agc = 0; // manual
-        last.if_gain_val = nxt.if_gain_val + 1;
-        last.if_gain_idx = nxt.if_gain_idx + 1;
         trigger_control(CtrlFlags::if_agc_gain);
         BOOL enableIFGain = (isR82XX()) ? TRUE : FALSE;
         EnableWindow(hIFGain, enableIFGain);
@@ -785,7 +808,9 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
       {
         nxt.srate_idx = ComboBox_GetCurSel(GET_WM_COMMAND_HWND(wParam, lParam));
         trigger_control(CtrlFlags::srate);
-        EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);  // Signal application
+        // while streaming, RX thread signals at the first block with the new samplerate
+        if (!ThreadStreamToSDR.load())
+          EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_SampleRate);  // Signal application
       }
       if (0 && GET_WM_COMMAND_CMD(wParam, lParam) == CBN_EDITUPDATE)
       {
@@ -847,27 +872,31 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
       if (GET_WM_COMMAND_CMD(wParam, lParam) == CBN_SELCHANGE)
       {
         const int64_t prev_tuneFreq = nxt.tune_freq;
-        int64_t tmp_LO_freq = nxt.LO_freq;
         const int fs = rates::tab[nxt.srate_idx].valueInt;
-        nxt.band_center_sel = ComboBox_GetCurSel(GET_WM_COMMAND_HWND(wParam, lParam));
-        int band_center = 0;
-        if (nxt.band_center_sel == 1)
-          band_center = fs / 4;
-        else if (nxt.band_center_sel == 2)
-          band_center = -fs / 4;
-        nxt.band_center_LO_delta = band_center;
-
-        if (last.band_center_sel == 1)  // -> +fs/4
-          tmp_LO_freq += fs / 4;
-        else if (last.band_center_sel == 2)  // -> -fs/4
-          tmp_LO_freq -= fs / 4;
-
-        if (nxt.band_center_sel == 1)  // -> +fs/4
-          tmp_LO_freq -= fs / 4;
-        else if (nxt.band_center_sel == 2)  // -> -fs/4
-          tmp_LO_freq += fs / 4;
-
-        nxt.LO_freq = tmp_LO_freq;
+        {
+          // band center and LO are one transition
+          ControlVars::WriteBatch batch(nxt);
+          int64_t tmp_LO_freq = nxt.LO_freq;
+          nxt.band_center_sel = ComboBox_GetCurSel(GET_WM_COMMAND_HWND(wParam, lParam));
+          int band_center = 0;
+          if (nxt.band_center_sel == 1)
+            band_center = fs / 4;
+          else if (nxt.band_center_sel == 2)
+            band_center = -fs / 4;
+          nxt.band_center_LO_delta = band_center;
+
+          if (last.band_center_sel == 1)  // -> +fs/4
+            tmp_LO_freq += fs / 4;
+          else if (last.band_center_sel == 2)  // -> -fs/4
+            tmp_LO_freq -= fs / 4;
+
+          if (nxt.band_center_sel == 1)  // -> +fs/4
+            tmp_LO_freq -= fs / 4;
+          else if (nxt.band_center_sel == 2)  // -> -fs/4
+            tmp_LO_freq += fs / 4;
+
+          nxt.LO_freq = tmp_LO_freq;
+        }
         trigger_control(CtrlFlags::tuner_band_center | CtrlFlags::freq);
 
         EXTIO_STATUS_CHANGE(gpfnExtIOCallbackPtr, extHw_Changed_LO);
@@ -898,6 +927,7 @@ INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPARAM lPar
         else if (RtlSdrDev && !ThreadStreamToSDR.load())
           // && !RtlDeviceInfo::is_same(RtlOpenDevice, RtlDeviceList[RtlSelectedDeviceIdx]))
         {
+          Stop_RX_Thread();   // still streaming after warm stop?
           open_selected_rtl_device();
           post_update_gui_init();  // post_update_gui_fields();
         }
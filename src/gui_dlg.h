@@ -4,6 +4,7 @@
 #include <Windows.h>
 #endif
 #include <atomic>
+#include <chrono>
 
 #define MAX_PPM   1000
 #define MIN_PPM   -1000
@@ -23,6 +24,9 @@ void gui_show_invalid_device();
 void post_update_gui_init();
 void post_update_gui_fields();
 
+// records latency::open_to_gui_ready, when the GUI is next updated with a known tuner
+void gui_measure_ready(std::chrono::steady_clock::time_point t0);
+
 void gui_SetSrate(int srate_idx);
 void gui_SetAttenuator(int atten_idx);
 void gui_SetMGC(int mgc_idx);
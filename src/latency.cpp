@@ -0,0 +1,126 @@
+
+#include "latency.h"
+
+#include <stdio.h>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+char latency_dump_fn[256] = "";
+
+const char* latency::names[latency::NUM_OPS] = {
+  "set_direct_sampling"
+, "set_offset_tuning"
+, "set_tuner_sideband"
+, "set_bias_tee"
+, "set_gpio"
+, "get_freq_correction"
+, "set_freq_correction"
+, "set_tuner_band_center"
+, "get_impulse_nc"
+, "set_impulse_nc"
+, "set_center_freq64"
+, "set_sample_rate"
+, "set_tuner_gain_mode"
+, "set_tuner_gain"
+, "set_tuner_if_mode"
+, "set_and_get_tuner_bandwidth"
+, "set_agc_mode"
+, "get_aagc"
+, "set_aagc"
+, "get_aagc_gain_distrib"
+, "set_aagc_gain_distrib"
+, "Control_Changes() total"
+, "StartHW() to first sample"
+, "OpenHW() to GUI ready"
+, "failover to standby sample"
+};
+
+namespace
+{
+
+struct atomic_hist
+{
+  std::atomic_uint64_t count;
+  std::atomic_uint64_t sum_us;
+  std::atomic_uint64_t max_us;
+  std::atomic_uint64_t bucket[latency::NUM_BUCKETS];
+};
+
+atomic_hist hists[latency::NUM_OPS];
+
+}
+
+
+void latency::record(op o, uint64_t duration_us)
+{
+  if (unsigned(o) >= NUM_OPS)
+    return;
+  atomic_hist& h = hists[o];
+  unsigned b = 0;
+  for (uint64_t v = duration_us; v > 1 && b < NUM_BUCKETS - 1; v >>= 1)
+    ++b;
+  h.bucket[b].fetch_add(1, std::memory_order_relaxed);
+  h.sum_us.fetch_add(duration_us, std::memory_order_relaxed);
+  uint64_t prev = h.max_us.load(std::memory_order_relaxed);
+  while (prev < duration_us && !h.max_us.compare_exchange_weak(prev, duration_us, std::memory_order_relaxed))
+    ;
+  h.count.fetch_add(1, std::memory_order_release);
+}
+
+
+void latency::get(op o, hist& out)
+{
+  const atomic_hist& h = hists[o];
+  out.count = h.count.load(std::memory_order_acquire);
+  out.sum_us = h.sum_us.load(std::memory_order_relaxed);
+  out.max_us = h.max_us.load(std::memory_order_relaxed);
+  for (unsigned b = 0; b < NUM_BUCKETS; ++b)
+    out.bucket[b] = h.bucket[b].load(std::memory_order_relaxed);
+}
+
+
+void latency::clear()
+{
+  for (unsigned o = 0; o < NUM_OPS; ++o)
+  {
+    atomic_hist& h = hists[o];
+    h.count = 0;
+    h.sum_us = 0;
+    h.max_us = 0;
+    for (unsigned b = 0; b < NUM_BUCKETS; ++b)
+      h.bucket[b] = 0;
+  }
+}
+
+
+bool latency::dump(const char* filename)
+{
+  if (!filename || !filename[0])
+    return false;
+  FILE* f = fopen(filename, "w");
+  if (!f)
+    return false;
+
+  fprintf(f, "# latency of librtlsdr calls in microseconds. bucket columns: count of durations < 2^(k+1) us\n");
+  fprintf(f, "%-28s %8s %10s %10s", "operation", "count", "mean", "max");
+  for (unsigned b = 0; b < NUM_BUCKETS; ++b)
+    fprintf(f, " %7llu", 2ULL << b);
+  fprintf(f, "\n");
+
+  for (unsigned o = 0; o < NUM_OPS; ++o)
+  {
+    hist h;
+    get(op(o), h);
+    if (!h.count)
+      continue;
+    fprintf(f, "%-28s %8llu %10llu %10llu", names[o], (unsigned long long)h.count,
+      (unsigned long long)(h.sum_us / h.count), (unsigned long long)h.max_us);
+    for (unsigned b = 0; b < NUM_BUCKETS; ++b)
+      fprintf(f, " %7llu", (unsigned long long)h.bucket[b]);
+    fprintf(f, "\n");
+  }
+  fclose(f);
+  return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+// latency histograms of the librtlsdr calls in Control_Changes():
+//   to find out, which tuner operations dominate the retune latency.
+// buckets are logarithmic: bucket k counts durations in [2^k, 2^(k+1)) microseconds.
+// written from the control path, readable from any thread at any time.
+
+struct latency
+{
+  enum op
+  {
+    set_direct_sampling = 0
+    , set_offset_tuning
+    , set_tuner_sideband
+    , set_bias_tee
+    , set_gpio
+    , get_freq_correction
+    , set_freq_correction
+    , set_tuner_band_center
+    , get_impulse_nc
+    , set_impulse_nc
+    , set_center_freq
+    , set_sample_rate
+    , set_tuner_gain_mode
+    , set_tuner_gain
+    , set_tuner_if_mode
+    , set_tuner_bandwidth
+    , set_agc_mode
+    , get_aagc
+    , set_aagc
+    , get_aagc_gain_distrib
+    , set_aagc_gain_distrib
+    , control_changes   // the whole Control_Changes() pass
+    , start_to_first_sample   // StartHW() until first received block
+    , open_to_gui_ready       // OpenHW() until the GUI shows the tuner's controls
+    , failover_to_first_sample  // failover decision until first delivered block of the standby
+    , NUM_OPS
+  };
+
+  static constexpr unsigned NUM_BUCKETS = 24;   // up to 2^24 us ~= 16 s
+
+  struct hist
+  {
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+    uint64_t bucket[NUM_BUCKETS];
+  };
+
+  static const char* names[NUM_OPS];
+
+  static void record(op o, uint64_t duration_us);
+  static void get(op o, hist& h);   // snapshot
+  static void clear();
+  static bool dump(const char* filename);   // text table. returns false on error
+
+  // measure f(), which returns the librtlsdr result
+  template <class F>
+  static int timed(op o, F&& f)
+  {
+    const auto t0 = std::chrono::steady_clock::now();
+    const int r = f();
+    const auto dt = std::chrono::steady_clock::now() - t0;
+    record(o, uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(dt).count()));
+    return r;
+  }
+
+  // measures the lifetime of the scope
+  struct scope
+  {
+    explicit scope(op o_) : o(o_), t0(std::chrono::steady_clock::now()) { }
+    ~scope()
+    {
+      const auto dt = std::chrono::steady_clock::now() - t0;
+      record(o, uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(dt).count()));
+    }
+    const op o;
+    const std::chrono::steady_clock::time_point t0;
+  };
+};
+
+#define LATENCY_TIMED( OP, CALL )  latency::timed(latency::OP, [&]() { return int(CALL); })
+
+// dump histograms at StopHW() / CloseHW() into this file. empty == no dump
+extern char latency_dump_fn[256];
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// bounded lock free multi producer / single consumer queue.
+//   each cell carries a sequence number (D. Vyukov's bounded queue), so producers
+//   only contend on one atomic increment. N must be a power of 2.
+//   push() fails, when the queue is full - the caller has to handle that.
+
+template <typename T, unsigned N>
+struct MpscQueue
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of 2");
+
+  MpscQueue()
+  {
+    for (unsigned k = 0; k < N; ++k)
+      cells[k].seq.store(k, std::memory_order_relaxed);
+    enqueue_pos.store(0, std::memory_order_relaxed);
+    dequeue_pos = 0;
+  }
+
+  // any thread
+  bool push(const T& v)
+  {
+    uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      Cell& cell = cells[pos & (N - 1)];
+      const uint32_t seq = cell.seq.load(std::memory_order_acquire);
+      const int32_t dif = int32_t(seq - pos);
+      if (dif == 0)
+      {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          cell.data = v;
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (dif < 0)
+        return false;   // full
+      else
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  // consumer thread only
+  bool pop(T& v)
+  {
+    Cell& cell = cells[dequeue_pos & (N - 1)];
+    const uint32_t seq = cell.seq.load(std::memory_order_acquire);
+    if (int32_t(seq - (dequeue_pos + 1)) < 0)
+      return false;   // empty
+    v = cell.data;
+    cell.seq.store(dequeue_pos + N, std::memory_order_release);
+    ++dequeue_pos;
+    return true;
+  }
+
+private:
+  struct alignas(64) Cell
+  {
+    std::atomic<uint32_t> seq;
+    T data;
+  };
+
+  Cell cells[N];
+  alignas(64) std::atomic<uint32_t> enqueue_pos;
+  alignas(64) uint32_t dequeue_pos;
+};
@@ -0,0 +1,278 @@
+
+#include <windows.h>
+
+#include "ExtIO_RTL_multi.h"
+#include "ExtIO_RTL.h"
+#include "rtl_dev_ctx.h"
+#include "coherent.h"
+
+// exported C API over RtlDevCtx and CoherentAligner. see ExtIO_RTL_multi.h
+
+struct RtlCtxApi
+{
+  RtlDevCtx* dev;
+  pfnRtlCtxSamples cb;
+  void* user;
+};
+
+
+static void rtl_ctx_samples(RtlDevCtx& ctx, const uint8_t* iq, uint32_t n_iq_pairs, int64_t first_idx, void* user)
+{
+  RtlCtxApi* h = (RtlCtxApi*)user;
+  h->cb(h, iq, n_iq_pairs, first_idx, h->user);
+}
+
+static RtlCtxHandle wrap(RtlDevCtx* dev)
+{
+  if (!dev)
+    return nullptr;
+  RtlCtxApi* h = new RtlCtxApi;
+  h->dev = dev;
+  h->cb = nullptr;
+  h->user = nullptr;
+  return h;
+}
+
+
+extern "C"
+RtlCtxHandle LIBRTL_API EXTIO_CALL RtlCtxOpen(uint32_t dev_idx)
+{
+  return wrap(RtlDevCtx::open(dev_idx));
+}
+
+extern "C"
+RtlCtxHandle LIBRTL_API EXTIO_CALL RtlCtxOpenSerial(const char* serial)
+{
+  return (serial) ? wrap(RtlDevCtx::open_serial(serial)) : nullptr;
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL RtlCtxClose(RtlCtxHandle h)
+{
+  if (!h)
+    return;
+  RtlDevCtx::close(h->dev);
+  delete h;
+}
+
+
+extern "C"
+int LIBRTL_API EXTIO_CALL RtlCtxStart(RtlCtxHandle h, pfnRtlCtxSamples cb, void* user, uint32_t buf_len)
+{
+  if (!h || !cb)
+    return -1;
+  if (h->dev->is_streaming())
+    return (cb == h->cb && user == h->user) ? 0 : -1;
+  h->cb = cb;
+  h->user = user;
+  return h->dev->start(rtl_ctx_samples, h, buf_len);
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL RtlCtxStop(RtlCtxHandle h)
+{
+  if (h)
+    h->dev->stop();
+}
+
+
+extern "C"
+void LIBRTL_API EXTIO_CALL RtlCtxSetFreq(RtlCtxHandle h, int64_t freq)
+{
+  if (h)
+    h->dev->set_freq(freq);
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL RtlCtxSetSrate(RtlCtxHandle h, int srate)
+{
+  if (h)
+    h->dev->set_srate(srate);
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL RtlCtxSetGain(RtlCtxHandle h, int tenth_db)
+{
+  if (h)
+    h->dev->set_gain(tenth_db);
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL RtlCtxSetPpm(RtlCtxHandle h, int ppm)
+{
+  if (h)
+    h->dev->set_ppm(ppm);
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL RtlCtxSetBiasTee(RtlCtxHandle h, int on)
+{
+  if (h)
+    h->dev->set_bias_tee(on);
+}
+
+
+extern "C"
+const char* LIBRTL_API EXTIO_CALL RtlCtxGetSerial(RtlCtxHandle h)
+{
+  return (h) ? h->dev->get_serial() : "";
+}
+
+extern "C"
+int64_t LIBRTL_API EXTIO_CALL RtlCtxGetSampleCount(RtlCtxHandle h)
+{
+  return (h) ? h->dev->get_sample_count() : 0;
+}
+
+
+struct CoherentApi
+{
+  CoherentAligner aligner;
+  pfnCoherentBlock cb = nullptr;
+  void* cb_user = nullptr;
+  pfnCoherentInject inject = nullptr;
+  void* inject_user = nullptr;
+};
+
+
+static void coherent_block(const float* const* iq, unsigned n_dev, uint32_t n_pairs, int64_t ref_idx, bool realigned, void* user)
+{
+  CoherentApi* h = (CoherentApi*)user;
+  h->cb(h, iq, n_dev, n_pairs, ref_idx, realigned ? 1 : 0, h->cb_user);
+}
+
+static void coherent_inject(bool on, void* user)
+{
+  CoherentApi* h = (CoherentApi*)user;
+  h->inject(h, on ? 1 : 0, h->inject_user);
+}
+
+
+extern "C"
+CoherentHandle LIBRTL_API EXTIO_CALL CoherentCreate(unsigned n_dev, uint32_t block_len, unsigned corr_len, uint32_t ring_len, unsigned n_workers)
+{
+  CoherentApi* h = new CoherentApi;
+  if (!h->aligner.init(n_dev, block_len, corr_len, ring_len, n_workers))
+  {
+    delete h;
+    return nullptr;
+  }
+  return h;
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL CoherentDestroy(CoherentHandle h)
+{
+  delete h;   // the aligner's destructor stops and releases
+}
+
+
+extern "C"
+void LIBRTL_API EXTIO_CALL CoherentSetCallback(CoherentHandle h, pfnCoherentBlock cb, void* user)
+{
+  if (!h)
+    return;
+  h->cb = cb;
+  h->cb_user = user;
+  h->aligner.set_callback((cb) ? coherent_block : nullptr, h);
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL CoherentSetInjector(CoherentHandle h, pfnCoherentInject fn, void* user)
+{
+  if (!h)
+    return;
+  h->inject = fn;
+  h->inject_user = user;
+  h->aligner.set_injector((fn) ? coherent_inject : nullptr, h);
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL CoherentSetBurstDetect(CoherentHandle h, int on, float threshold_db)
+{
+  if (h)
+    h->aligner.set_burst_detect(on != 0, threshold_db);
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL CoherentSetMinCorrelation(CoherentHandle h, float rho)
+{
+  if (h)
+    h->aligner.set_min_correlation(rho);
+}
+
+
+extern "C"
+int LIBRTL_API EXTIO_CALL CoherentStart(CoherentHandle h, const RtlCtxHandle* devs, uint32_t usb_buf_len)
+{
+  if (!h || !devs)
+    return -1;
+  RtlDevCtx* ctx[CoherentAligner::MAX_DEVICES];
+  for (unsigned k = 0; k < CoherentAligner::MAX_DEVICES; ++k)
+    ctx[k] = nullptr;
+  for (unsigned k = 0; k < h->aligner.num_devices(); ++k)
+  {
+    if (!devs[k])
+      return -1;
+    ctx[k] = devs[k]->dev;
+  }
+  return h->aligner.start(ctx, usb_buf_len);
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL CoherentStop(CoherentHandle h)
+{
+  if (h)
+    h->aligner.stop();
+}
+
+
+extern "C"
+void LIBRTL_API EXTIO_CALL CoherentCalibrate(CoherentHandle h)
+{
+  if (h)
+    h->aligner.calibrate();
+}
+
+extern "C"
+void LIBRTL_API EXTIO_CALL CoherentInjectBurst(CoherentHandle h)
+{
+  if (h)
+    h->aligner.inject_burst();
+}
+
+
+extern "C"
+int LIBRTL_API EXTIO_CALL CoherentIsAligned(CoherentHandle h)
+{
+  return (h && h->aligner.is_aligned()) ? 1 : 0;
+}
+
+extern "C"
+unsigned LIBRTL_API EXTIO_CALL CoherentGetGeneration(CoherentHandle h)
+{
+  return (h) ? h->aligner.generation() : 0;
+}
+
+extern "C"
+int LIBRTL_API EXTIO_CALL CoherentGetOffset(CoherentHandle h, unsigned k, int64_t* samples, float* frac, float* phase, float* corr)
+{
+  if (!h || k >= h->aligner.num_devices())
+    return -1;
+  const CoherentAligner::Offset o = h->aligner.get_offset(k);
+  if (samples)
+    *samples = o.samples;
+  if (frac)
+    *frac = o.frac;
+  if (phase)
+    *phase = o.phase;
+  if (corr)
+    *corr = o.corr;
+  return 0;
+}
+
+extern "C"
+uint64_t LIBRTL_API EXTIO_CALL CoherentGetOverruns(CoherentHandle h)
+{
+  return (h) ? h->aligner.get_overruns() : 0;
+}
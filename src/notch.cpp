@@ -0,0 +1,244 @@
+
+#include "notch.h"
+
+#include <atomic>
+#include <mutex>
+#include <cmath>
+
+// first order complex notch per spur:
+//   H(z) = ( 1 - c * z^-1 ) / ( 1 - r * c * z^-1 )   with c = exp(j * w0)
+// zero on the unit circle at the spur; pole just inside; -3 dB width ~= 2 * (1 - r)
+
+namespace
+{
+
+struct NotchParams    // published from control path to RX thread
+{
+  std::atomic_uint32_t seq{ 0 };      // odd while writing
+  std::atomic_uint32_t num{ 0 };      // number of used slots
+  std::atomic_int en[notch::MAX_NOTCHES];
+  std::atomic<float> c_re[notch::MAX_NOTCHES];
+  std::atomic<float> c_im[notch::MAX_NOTCHES];
+  std::atomic<float> p_re[notch::MAX_NOTCHES];
+  std::atomic<float> p_im[notch::MAX_NOTCHES];
+};
+
+struct NotchCtrl      // control path only - protected by ctrl_mutex
+{
+  double spur[notch::MAX_NOTCHES];
+  double offset[notch::MAX_NOTCHES];  // currently applied offset to LO
+  unsigned num = 0;
+  double bw = notch::DEFAULT_BW;
+  int64_t lo = 0;
+  int fs = 0;
+};
+
+struct NotchRx        // RX thread only
+{
+  uint32_t seq = 0;
+  unsigned n_active = 0;
+  unsigned slot[notch::MAX_NOTCHES];
+  float c_re[notch::MAX_NOTCHES], c_im[notch::MAX_NOTCHES];
+  float p_re[notch::MAX_NOTCHES], p_im[notch::MAX_NOTCHES];
+  // filter states per slot: previous input and output
+  float x1_re[notch::MAX_NOTCHES], x1_im[notch::MAX_NOTCHES];
+  float y1_re[notch::MAX_NOTCHES], y1_im[notch::MAX_NOTCHES];
+};
+
+NotchParams params;
+NotchCtrl ctrl;
+NotchRx rx;
+std::mutex ctrl_mutex;
+
+}
+
+
+static void publish_begin()
+{
+  params.seq.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+static void publish_end()
+{
+  params.seq.fetch_add(1, std::memory_order_release);
+}
+
+// recompute slot k - return true, if coefficients changed
+static bool compute_slot(unsigned k, bool force)
+{
+  const double fs = double(ctrl.fs);
+  const double off = ctrl.spur[k] - double(ctrl.lo);
+  const bool in_band = (fs > 0.0 && std::fabs(off) < 0.5 * fs);
+  if (!force && in_band == (params.en[k].load(std::memory_order_relaxed) != 0) && off == ctrl.offset[k])
+    return false;
+
+  ctrl.offset[k] = off;
+  if (!in_band)
+  {
+    params.en[k].store(0, std::memory_order_relaxed);
+    return true;
+  }
+
+  const double pi = 3.14159265358979323846;
+  const double w0 = 2.0 * pi * off / fs;
+  double r = 1.0 - pi * ctrl.bw / fs;
+  if (r < 0.9)
+    r = 0.9;
+  else if (r > 0.99999)
+    r = 0.99999;
+  const double cr = std::cos(w0);
+  const double ci = std::sin(w0);
+  params.c_re[k].store(float(cr), std::memory_order_relaxed);
+  params.c_im[k].store(float(ci), std::memory_order_relaxed);
+  params.p_re[k].store(float(r * cr), std::memory_order_relaxed);
+  params.p_im[k].store(float(r * ci), std::memory_order_relaxed);
+  params.en[k].store(1, std::memory_order_relaxed);
+  return true;
+}
+
+
+void notch_set_frequencies(const double* spur_freqs, unsigned n, double bw_hz)
+{
+  std::lock_guard<std::mutex> lock(ctrl_mutex);
+  if (n > notch::MAX_NOTCHES)
+    n = notch::MAX_NOTCHES;
+
+  publish_begin();
+  for (unsigned k = 0; k < n; ++k)
+    ctrl.spur[k] = spur_freqs[k];
+  for (unsigned k = n; k < ctrl.num; ++k)
+    params.en[k].store(0, std::memory_order_relaxed);
+  ctrl.num = n;
+  ctrl.bw = (bw_hz > 0.0) ? bw_hz : notch::DEFAULT_BW;
+  for (unsigned k = 0; k < n; ++k)
+    compute_slot(k, true);
+  params.num.store(n, std::memory_order_relaxed);
+  publish_end();
+}
+
+
+void notch_update_tuning(int64_t lo_freq, int samplerate)
+{
+  std::lock_guard<std::mutex> lock(ctrl_mutex);
+  const bool fs_changed = (samplerate != ctrl.fs);
+  if (!fs_changed && lo_freq == ctrl.lo)
+    return;
+  ctrl.lo = lo_freq;
+  ctrl.fs = samplerate;
+  if (!ctrl.num)
+    return;
+
+  publish_begin();
+  for (unsigned k = 0; k < ctrl.num; ++k)
+    compute_slot(k, fs_changed);
+  publish_end();
+}
+
+
+void notch_reset_state()
+{
+  for (unsigned k = 0; k < notch::MAX_NOTCHES; ++k)
+    rx.x1_re[k] = rx.x1_im[k] = rx.y1_re[k] = rx.y1_im[k] = 0.0F;
+}
+
+
+// RX thread: take over published coefficients, if there are new ones.
+//   filter states are kept for the slots - thus retuning doesn't click
+static void fetch_params()
+{
+  const uint32_t s1 = params.seq.load(std::memory_order_acquire);
+  if (s1 == rx.seq || (s1 & 1))
+    return;   // nothing new or writer active: retry with next block
+
+  NotchRx tmp;
+  tmp.n_active = 0;
+  const unsigned num = params.num.load(std::memory_order_relaxed);
+  for (unsigned k = 0; k < num && k < notch::MAX_NOTCHES; ++k)
+  {
+    if (!params.en[k].load(std::memory_order_relaxed))
+      continue;
+    const unsigned a = tmp.n_active++;
+    tmp.slot[a] = k;
+    tmp.c_re[a] = params.c_re[k].load(std::memory_order_relaxed);
+    tmp.c_im[a] = params.c_im[k].load(std::memory_order_relaxed);
+    tmp.p_re[a] = params.p_re[k].load(std::memory_order_relaxed);
+    tmp.p_im[a] = params.p_im[k].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (params.seq.load(std::memory_order_relaxed) != s1)
+    return;   // torn read
+
+  rx.seq = s1;
+  rx.n_active = tmp.n_active;
+  for (unsigned a = 0; a < tmp.n_active; ++a)
+  {
+    rx.slot[a] = tmp.slot[a];
+    rx.c_re[a] = tmp.c_re[a];
+    rx.c_im[a] = tmp.c_im[a];
+    rx.p_re[a] = tmp.p_re[a];
+    rx.p_im[a] = tmp.p_im[a];
+  }
+}
+
+
+static inline void filter_sample(float& re, float& im)
+{
+  for (unsigned a = 0; a < rx.n_active; ++a)
+  {
+    const unsigned k = rx.slot[a];
+    // y = x - c * x1 + p * y1
+    const float yr = re - (rx.c_re[a] * rx.x1_re[k] - rx.c_im[a] * rx.x1_im[k])
+      + (rx.p_re[a] * rx.y1_re[k] - rx.p_im[a] * rx.y1_im[k]);
+    const float yi = im - (rx.c_re[a] * rx.x1_im[k] + rx.c_im[a] * rx.x1_re[k])
+      + (rx.p_re[a] * rx.y1_im[k] + rx.p_im[a] * rx.y1_re[k]);
+    rx.x1_re[k] = re;
+    rx.x1_im[k] = im;
+    rx.y1_re[k] = yr;
+    rx.y1_im[k] = yi;
+    re = yr;
+    im = yi;
+  }
+}
+
+
+bool notch_process_pcm16(int16_t* iq, int n_iq_pairs)
+{
+  fetch_params();
+  if (!rx.n_active)
+    return false;
+
+  for (int i = 0; i < n_iq_pairs; ++i)
+  {
+    float re = iq[2 * i];
+    float im = iq[2 * i + 1];
+    filter_sample(re, im);
+    iq[2 * i] = int16_t(std::lrint(re));
+    iq[2 * i + 1] = int16_t(std::lrint(im));
+  }
+  return true;
+}
+
+
+static inline uint8_t to_u8(float v)
+{
+  long r = std::lrint(v) + 128;
+  return uint8_t((r < 0) ? 0 : (r > 255) ? 255 : r);
+}
+
+bool notch_process_u8(uint8_t* iq, int n_iq_pairs)
+{
+  fetch_params();
+  if (!rx.n_active)
+    return false;
+
+  for (int i = 0; i < n_iq_pairs; ++i)
+  {
+    float re = float(int(iq[2 * i]) - 128);
+    float im = float(int(iq[2 * i + 1]) - 128);
+    filter_sample(re, im);
+    iq[2 * i] = to_u8(re);
+    iq[2 * i + 1] = to_u8(im);
+  }
+  return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+// bank of narrow complex IIR notches - against the fixed spurs of the RTL dongles,
+//   e.g. at crystal harmonics (28.8 MHz * N) and some fs related frequencies.
+//
+// the spur frequencies are absolute (RF) frequencies - set per band from rtl_sdr_extio.cfg.
+// the coefficients depend on the LO and the samplerate: notch_update_tuning() recomputes
+//   only the notches, which moved. coefficients are handed over to the RX thread
+//   without locks and without any allocation.
+
+struct notch
+{
+  static constexpr unsigned MAX_NOTCHES = 16;
+  static constexpr double DEFAULT_BW = 500.0;   // -3 dB bandwidth in Hz
+};
+
+// control path: set spur frequencies (in Hz) of the current band. n == 0 disables
+void notch_set_frequencies(const double* spur_freqs, unsigned n, double bw_hz);
+
+// control path: after retune or samplerate change
+void notch_update_tuning(int64_t lo_freq, int samplerate);
+
+// RX thread: reset filter states - at start of streaming
+void notch_reset_state();
+
+// RX thread: process interleaved I/Q samples in place - centered at 0 (pcm16) / 128 (u8)
+//   return false, when no notch is active - the samples are untouched then
+bool notch_process_pcm16(int16_t* iq, int n_iq_pairs);
+bool notch_process_u8(uint8_t* iq, int n_iq_pairs);
@@ -0,0 +1,145 @@
+
+#include "real2cplx.h"
+
+#include <cmath>
+
+std::atomic_int real2cplx_enable = 0;
+
+namespace
+{
+
+// half-band filter of length 4*K - 1: the even output branch uses 2*K taps,
+//   the odd branch is delayed by K samples
+constexpr int K = 12;
+constexpr int NT = 2 * K;
+constexpr int CHUNK = 4096;   // output pairs per inner loop
+
+struct R2CState
+{
+  bool taps_ready = false;
+  alignas(64) float g[NT];                // even branch taps, sum = 1
+  alignas(64) float e[NT - 1 + CHUNK];    // even branch: history + new samples
+  alignas(64) float o[K + CHUNK];         // odd branch: delay line + new samples
+  alignas(64) float out_re[CHUNK];
+  int sign_phase = 0;                     // (-1)^p of next even/odd input pair
+};
+
+R2CState st;
+
+}
+
+
+static void init_taps()
+{
+  const double pi = 3.14159265358979323846;
+  const int len = 4 * K - 1;     // full half-band length
+  const int c = 2 * K - 1;       // its center
+  double sum = 0.0;
+  for (int i = 0; i < NT; ++i)
+  {
+    const int d = 2 * i - c;     // odd distance from center
+    const double x = 0.5 * d;
+    const double sinc = std::sin(pi * x) / (pi * x);
+    const int n = 2 * i;
+    const double w = 0.42 - 0.5 * std::cos(2.0 * pi * n / (len - 1)) + 0.08 * std::cos(4.0 * pi * n / (len - 1));
+    st.g[i] = float(sinc * w);
+    sum += sinc * w;
+  }
+  for (int i = 0; i < NT; ++i)
+    st.g[i] = float(st.g[i] / sum);
+  st.taps_ready = true;
+}
+
+
+void real2cplx_reset()
+{
+  if (!st.taps_ready)
+    init_taps();
+  for (int k = 0; k < NT - 1; ++k)
+    st.e[k] = 0.0F;
+  for (int k = 0; k < K; ++k)
+    st.o[k] = 0.0F;
+  st.sign_phase = 0;
+}
+
+
+// convert up to CHUNK output pairs: results in st.out_re[] and st.o[0 .. n_out - 1] (negated)
+static void convert_chunk(const uint8_t* iq, int n_out, int branch)
+{
+  float* e = st.e + (NT - 1);
+  float* o = st.o + K;
+  // shift by -fs/4: x[n] * (1, -j, -1, j, ..): split into even (real) and odd (imag) samples
+  float sgn = (st.sign_phase & 1) ? -1.0F : 1.0F;
+  for (int p = 0; p < n_out; ++p)
+  {
+    e[p] = sgn * (float(iq[4 * p + branch]) - 127.5F);
+    o[p] = sgn * (float(iq[4 * p + 2 + branch]) - 127.5F);
+    sgn = -sgn;
+  }
+  st.sign_phase = (st.sign_phase + n_out) & 1;
+
+  // even branch: FIR. taps in outer loop, contiguous samples in inner loop: vectorizes
+  for (int m = 0; m < n_out; ++m)
+    st.out_re[m] = 0.0F;
+  for (int i = 0; i < NT; ++i)
+  {
+    const float gi = st.g[i];
+    const float* src = e - i;
+    for (int m = 0; m < n_out; ++m)
+      st.out_re[m] += gi * src[m];
+  }
+}
+
+static void keep_history(int n_out)
+{
+  for (int k = 0; k < NT - 1; ++k)
+    st.e[k] = st.e[n_out + k];
+  for (int k = 0; k < K; ++k)
+    st.o[k] = st.o[n_out + k];
+}
+
+
+int real2cplx_pcm16(const uint8_t* iq, int n_iq_pairs, int branch, int16_t* out_iq)
+{
+  const int n_total = n_iq_pairs / 2;
+  for (int done = 0; done < n_total; )
+  {
+    const int n_out = (n_total - done < CHUNK) ? (n_total - done) : CHUNK;
+    convert_chunk(iq + 4 * done, n_out, branch);
+    int16_t* dst = out_iq + 2 * done;
+    for (int m = 0; m < n_out; ++m)
+    {
+      dst[2 * m] = int16_t(std::lrint(st.out_re[m]));
+      dst[2 * m + 1] = int16_t(std::lrint(-st.o[m]));   // delayed by K
+    }
+    keep_history(n_out);
+    done += n_out;
+  }
+  return n_total;
+}
+
+
+static inline uint8_t to_u8(float v)
+{
+  long r = std::lrint(v + 127.5F);
+  return uint8_t((r < 0) ? 0 : (r > 255) ? 255 : r);
+}
+
+int real2cplx_u8(const uint8_t* iq, int n_iq_pairs, int branch, uint8_t* out_iq)
+{
+  const int n_total = n_iq_pairs / 2;
+  for (int done = 0; done < n_total; )
+  {
+    const int n_out = (n_total - done < CHUNK) ? (n_total - done) : CHUNK;
+    convert_chunk(iq + 4 * done, n_out, branch);
+    uint8_t* dst = out_iq + 2 * done;
+    for (int m = 0; m < n_out; ++m)
+    {
+      dst[2 * m] = to_u8(st.out_re[m]);
+      dst[2 * m + 1] = to_u8(-st.o[m]);
+    }
+    keep_history(n_out);
+    done += n_out;
+  }
+  return n_total;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// real to complex conversion for the direct sampling modes (sampling_mode 1 / 2):
+//   only one branch (I or Q) of the I/Q stream carries the real ADC signal.
+//   the real stream at fs is shifted by -fs/4, half-band filtered and decimated by 2.
+//   result is a complex baseband at fs/2, centered at real frequency fs/4.
+//
+// with the half-band filter, the odd output (Q) is just a delayed input sample, the even
+//   output (I) is a short symmetric FIR - a Hilbert transformer pair.
+
+// 0 == off: deliver I/Q as received. 1 == convert in direct sampling modes
+extern std::atomic_int real2cplx_enable;
+
+inline bool real2cplx_active(int sampling_mode)
+{
+  return (sampling_mode == 1 || sampling_mode == 2) && real2cplx_enable.load() != 0;
+}
+
+// RX thread: clear filter history - at start of streaming or at mode change
+void real2cplx_reset();
+
+// RX thread: convert n_iq_pairs received u8 I/Q pairs, using branch 0 = I or 1 = Q.
+//   writes n_iq_pairs / 2 complex output pairs. returns the number of output pairs
+int real2cplx_pcm16(const uint8_t* iq, int n_iq_pairs, int branch, int16_t* out_iq);
+int real2cplx_u8(const uint8_t* iq, int n_iq_pairs, int branch, uint8_t* out_iq);
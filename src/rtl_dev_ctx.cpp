@@ -0,0 +1,358 @@
+
+#include "rtl_dev_ctx.h"
+#include "control.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <windows.h>
+#include <process.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+#define SDRLG( A, TEXT, ...) do { if ( gpfnExtIOCallbackPtr ) { snprintf(acMsg, 255, TEXT, __VA_ARGS__); gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); } } while (0)
+
+
+static std::atomic_uint num_open_ctx{ 0 };
+
+
+unsigned RtlDevCtx::num_open()
+{
+  return num_open_ctx.load();
+}
+
+
+RtlDevCtx* RtlDevCtx::open(uint32_t dev_idx)
+{
+  std::unique_lock<std::mutex> enum_lock = lock_rtl_enumeration();
+  return open_locked(dev_idx, enum_lock);
+}
+
+
+RtlDevCtx* RtlDevCtx::open_locked(uint32_t dev_idx, std::unique_lock<std::mutex>& enum_lock)
+{
+  char acMsg[256];
+  RtlDevCtx* c = new RtlDevCtx;
+  c->dev_idx = dev_idx;
+  c->rx_thread = INVALID_HANDLE_VALUE;
+  char vendor[256], product[256];
+  if (rtlsdr_get_device_usb_strings(dev_idx, vendor, product, c->serial) < 0)
+    c->serial[0] = 0;
+
+  int r = rtlsdr_open(&c->dev, dev_idx);
+  enum_lock.unlock();
+  if (r < 0 || !c->dev)
+  {
+    SDRLG(extHw_MSG_ERROR, "RtlDevCtx::open(%u): error %d at rtlsdr_open()", dev_idx, r);
+    delete c;
+    return nullptr;
+  }
+
+  c->control_event = CreateEvent(NULL, FALSE, FALSE, NULL);  // auto-reset
+  c->control_thread = (c->control_event) ? (void*)_beginthread(control_thread_proc, 0, c) : INVALID_HANDLE_VALUE;
+  if (c->control_thread == INVALID_HANDLE_VALUE)
+  {
+    SDRLG(extHw_MSG_ERROR, "RtlDevCtx::open(%u): error starting control thread", dev_idx);
+    if (c->control_event)
+      CloseHandle(c->control_event);
+    rtlsdr_close(c->dev);
+    delete c;
+    return nullptr;
+  }
+
+  ++num_open_ctx;
+  SDRLG(extHw_MSG_DEBUG, "RtlDevCtx::open(%u): serial '%s'", dev_idx, c->serial);
+  c->trigger(Flags::initial);
+  return c;
+}
+
+
+RtlDevCtx* RtlDevCtx::open_serial(const char* serial)
+{
+  char acMsg[256];
+  // index and open under the same lock: a reconnect may renumber the devices in between
+  std::unique_lock<std::mutex> enum_lock = lock_rtl_enumeration();
+  const int idx = rtlsdr_get_index_by_serial(serial);
+  if (idx < 0)
+  {
+    enum_lock.unlock();
+    SDRLG(extHw_MSG_ERROR, "RtlDevCtx::open_serial('%s'): device not found", serial);
+    return nullptr;
+  }
+  return open_locked(uint32_t(idx), enum_lock);
+}
+
+
+void RtlDevCtx::close(RtlDevCtx* c)
+{
+  if (!c)
+    return;
+  c->stop();
+
+  c->terminate_control = true;
+  SetEvent(c->control_event);
+  if (c->control_thread != INVALID_HANDLE_VALUE)
+    WaitForSingleObject((HANDLE)c->control_thread, INFINITE);
+  CloseHandle(c->control_event);
+
+  rtlsdr_close(c->dev);
+  --num_open_ctx;
+  delete c;
+}
+
+
+// setters only trigger the control thread with changed values
+void RtlDevCtx::set_value(std::atomic_int& v, int n, uint32_t f)
+{
+  if (v.exchange(n) != n)
+    trigger(f);
+}
+
+void RtlDevCtx::set_freq(int64_t f)
+{
+  if (freq.exchange(f) != f)
+    trigger(Flags::freq);
+}
+
+void RtlDevCtx::set_srate(int s)          { set_value(srate, s, Flags::srate); }
+void RtlDevCtx::set_gain(int tenth_db)    { set_value(gain, tenth_db, Flags::gain); }
+void RtlDevCtx::set_ppm(int p)            { set_value(ppm, p, Flags::ppm); }
+void RtlDevCtx::set_bias_tee(int on)      { set_value(bias_tee, on ? 1 : 0, Flags::bias_tee); }
+void RtlDevCtx::set_direct_sampling(int mode) { set_value(direct_sampling, mode, Flags::direct_sampling); }
+void RtlDevCtx::set_offset_tuning(int on) { set_value(offset_tuning, on ? 1 : 0, Flags::offset_tuning); }
+void RtlDevCtx::set_sideband(int usb)     { set_value(sideband, usb ? 1 : 0, Flags::sideband); }
+void RtlDevCtx::set_bandwidth(int hz)     { set_value(bandwidth, hz, Flags::bandwidth); }
+void RtlDevCtx::set_if_mode(int mode)     { set_value(if_mode, mode, Flags::if_mode); }
+void RtlDevCtx::set_rtl_agc(int on)       { set_value(rtl_agc, on ? 1 : 0, Flags::rtl_agc); }
+void RtlDevCtx::set_band_center(int hz)   { set_value(band_center, hz, Flags::band_center); }
+void RtlDevCtx::set_impulse_nc(int on)    { set_value(impulse_nc, on ? 1 : 0, Flags::impulse_nc); }
+
+void RtlDevCtx::set_gpio(unsigned pin, int on)
+{
+  if (pin >= 8)
+    return;
+  const uint32_t bit = 1U << pin;
+  const uint32_t prev_used = gpio_used.fetch_or(bit);
+  const uint32_t prev_val = (on) ? gpio_val.fetch_or(bit) : gpio_val.fetch_and(~bit);
+  if (!(prev_used & bit) || ((prev_val & bit) != 0) != (on != 0))
+    trigger(Flags::gpio);
+}
+
+
+int RtlDevCtx::get_tuner_type() const
+{
+  return int(rtlsdr_get_tuner_type(dev));
+}
+
+
+void RtlDevCtx::trigger(uint32_t f)
+{
+  pending.fetch_or(f);
+  SetEvent(control_event);
+}
+
+
+// control thread - or synchronous from start()
+void RtlDevCtx::apply(uint32_t f)
+{
+  char acMsg[256];
+  std::lock_guard<std::mutex> lock(apply_mutex);
+  int r = 0;
+  int v;
+  // direct sampling before samplerate and frequency: it resets the tuner
+  if ((f & Flags::direct_sampling) && (v = direct_sampling.load()) != UNSET)
+  {
+    r = rtlsdr_set_direct_sampling(dev, v);
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_direct_sampling()", dev_idx, r);
+  }
+  if ((f & Flags::offset_tuning) && (v = offset_tuning.load()) != UNSET)
+  {
+    r = rtlsdr_set_offset_tuning(dev, v);
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_offset_tuning()", dev_idx, r);
+  }
+  if ((f & Flags::sideband) && (v = sideband.load()) != UNSET)
+  {
+    r = rtlsdr_set_tuner_sideband(dev, v);
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_tuner_sideband()", dev_idx, r);
+  }
+  if (f & Flags::srate)
+  {
+    r = rtlsdr_set_sample_rate(dev, uint32_t(srate.load()));
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_sample_rate()", dev_idx, r);
+  }
+  if (f & Flags::ppm)
+  {
+    r = rtlsdr_set_freq_correction(dev, ppm.load());
+    if (r < 0 && r != -2)   // -2 == unchanged
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_freq_correction()", dev_idx, r);
+  }
+  if ((f & Flags::band_center) && (v = band_center.load()) != UNSET)
+  {
+    r = rtlsdr_set_tuner_band_center(dev, v);
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_tuner_band_center()", dev_idx, r);
+  }
+  if (f & Flags::freq)
+  {
+    r = rtlsdr_set_center_freq64(dev, uint64_t(freq.load()));
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_center_freq64()", dev_idx, r);
+  }
+  if ((f & Flags::bandwidth) && (v = bandwidth.load()) != UNSET)
+  {
+    uint32_t applied_bw = 0;
+    r = rtlsdr_set_and_get_tuner_bandwidth(dev, uint32_t(v), &applied_bw, 1 /* =apply_bw */);
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_and_get_tuner_bandwidth()", dev_idx, r);
+  }
+  if (f & Flags::gain)
+  {
+    const int g = gain.load();
+    r = rtlsdr_set_tuner_gain_mode(dev, (g == GAIN_AUTO) ? 0 : 1);
+    if (r >= 0 && g != GAIN_AUTO)
+      r = rtlsdr_set_tuner_gain(dev, g);
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d setting tuner gain", dev_idx, r);
+  }
+  if ((f & Flags::if_mode) && (v = if_mode.load()) != UNSET)
+  {
+    r = rtlsdr_set_tuner_if_mode(dev, v);
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_tuner_if_mode()", dev_idx, r);
+  }
+  if ((f & Flags::rtl_agc) && (v = rtl_agc.load()) != UNSET)
+  {
+    r = rtlsdr_set_agc_mode(dev, v);
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_agc_mode()", dev_idx, r);
+  }
+  if ((f & Flags::impulse_nc) && (v = impulse_nc.load()) != UNSET)
+  {
+    r = rtlsdr_set_impulse_nc(dev, v, v);
+    if (r)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_impulse_nc()", dev_idx, r);
+  }
+  if (f & Flags::bias_tee)
+  {
+    r = rtlsdr_set_bias_tee(dev, bias_tee.load());
+    if (r < 0)
+      SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_bias_tee()", dev_idx, r);
+  }
+  if (f & Flags::gpio)
+  {
+    const uint32_t used = gpio_used.load();
+    const uint32_t val = gpio_val.load();
+    for (unsigned pin = 0; pin < 8; ++pin)
+    {
+      if (!((used >> pin) & 1U))
+        continue;
+      rtlsdr_set_gpio_output(dev, uint8_t(pin));
+      r = rtlsdr_set_gpio_bit(dev, uint8_t(pin), int((val >> pin) & 1U));
+      if (r < 0)
+        SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error %d at rtlsdr_set_gpio_bit(%u)", dev_idx, r, pin);
+    }
+  }
+}
+
+
+void RtlDevCtx::control_thread_proc(void* param)
+{
+  RtlDevCtx& c = *(RtlDevCtx*)param;
+  while (!c.terminate_control.load())
+  {
+    WaitForSingleObject(c.control_event, INFINITE);
+    const uint32_t f = c.pending.exchange(0);
+    if (f && !c.terminate_control.load())
+      c.apply(f);
+  }
+  c.control_thread = INVALID_HANDLE_VALUE;
+  _endthread();
+}
+
+
+int RtlDevCtx::start(SampleCallback cb, void* user, uint32_t buf_len)
+{
+  char acMsg[256];
+  if (rx_running.load())
+    return 0;   // all fine
+  if (!cb || !buf_len)
+    return -1;
+
+  // the samplerate must be set before the stream starts
+  apply(pending.exchange(0));
+
+  if (rtlsdr_reset_buffer(dev) < 0)
+  {
+    SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error at rtlsdr_reset_buffer()", dev_idx);
+    return -1;
+  }
+
+  callback = cb;
+  callback_user = user;
+  rx_buf_len = buf_len;
+  sample_count = 0;
+  terminate_rx = false;
+  rx_running = true;
+  rx_thread = (void*)_beginthread(rx_thread_proc, 0, this);
+  if (rx_thread == INVALID_HANDLE_VALUE)
+  {
+    rx_running = false;
+    SDRLG(extHw_MSG_ERROR, "RtlDevCtx(%u): error starting RX thread", dev_idx);
+    return -1;
+  }
+  return 0;
+}
+
+
+void RtlDevCtx::stop()
+{
+  if (!rx_running.load() && rx_thread == INVALID_HANDLE_VALUE)
+    return;
+  terminate_rx = true;
+  rtlsdr_cancel_async(dev);
+  if (rx_thread != INVALID_HANDLE_VALUE)
+    WaitForSingleObject((HANDLE)rx_thread, INFINITE);
+  rx_thread = INVALID_HANDLE_VALUE;
+  rx_running = false;
+}
+
+
+void RtlDevCtx::rx_callback(unsigned char* buf, uint32_t len, void* ctx)
+{
+  RtlDevCtx& c = *(RtlDevCtx*)ctx;
+  if (!buf || c.terminate_rx.load())
+    return;
+  const uint32_t n = len / 2;
+  const int64_t first = c.sample_count.load(std::memory_order_relaxed);
+  c.sample_count.store(first + n, std::memory_order_relaxed);
+  c.callback(c, buf, n, first, c.callback_user);
+}
+
+
+void RtlDevCtx::rx_thread_proc(void* param)
+{
+  char acMsg[256];
+  RtlDevCtx& c = *(RtlDevCtx*)param;
+  // Blocks until rtlsdr_cancel_async() is called
+  int r = rtlsdr_read_async(c.dev, (rtlsdr_read_async_cb_t)&rx_callback, &c, 0, c.rx_buf_len);
+  if (!c.terminate_rx.load())
+    SDRLG(extHw_MSG_WARNING, "RtlDevCtx(%u): rtlsdr_read_async() finished unexpected - with %d", c.dev_idx, r);
+  c.rx_running = false;
+  c.rx_thread = INVALID_HANDLE_VALUE;
+  _endthread();
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <rtl-sdr.h>
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+// one opened RTL dongle with its own RX and control thread.
+//   all state is in the context - independent of the ExtIO device (RtlSdrDev, nxt, last):
+//   several contexts stream in parallel, e.g. 4 - 8 dongles in one process.
+// the host's ExtIO device stays on the global path: the control path with band plans,
+//   settling, notch and GUI is built on it. contexts are the additional dongles:
+//   exported as C API (ExtIO_RTL_multi.h) - and the hot standby.
+// settings are stored by any thread and applied asynchronously by the control thread.
+// samples are passed raw (u8 I/Q) to the context's callback - in its RX thread.
+
+class RtlDevCtx
+{
+public:
+  // RX thread: n_iq_pairs received u8 I/Q pairs. first_idx: index of the first pair since start()
+  typedef void (*SampleCallback)(RtlDevCtx& ctx, const uint8_t* iq, uint32_t n_iq_pairs, int64_t first_idx, void* user);
+
+  static constexpr int GAIN_AUTO = -1000;
+  static constexpr int UNSET = -0x7FFFFFFF;   // not commanded: the device keeps its state
+
+  // nullptr on error
+  static RtlDevCtx* open(uint32_t dev_idx);
+  static RtlDevCtx* open_serial(const char* serial);
+  // stops streaming and closes the device
+  static void close(RtlDevCtx* ctx);
+
+  int start(SampleCallback cb, void* user, uint32_t buf_len);
+  void stop();
+  bool is_streaming() const { return rx_running.load(); }
+
+  void set_freq(int64_t freq);
+  void set_srate(int srate);
+  void set_gain(int tenth_db);    // GAIN_AUTO == tuner AGC
+  void set_ppm(int ppm);
+  void set_bias_tee(int on);
+  // not commanded, until set the first time
+  void set_direct_sampling(int mode);   // 0 == off, 1 == I-ADC, 2 == Q-ADC
+  void set_offset_tuning(int on);
+  void set_sideband(int usb);
+  void set_bandwidth(int hz);           // 0 == automatic
+  void set_if_mode(int mode);           // rtlsdr_set_tuner_if_mode(): 0 == IF AGC, 10000 + idx == gain
+  void set_rtl_agc(int on);
+  void set_band_center(int hz);
+  void set_impulse_nc(int on);
+  void set_gpio(unsigned pin, int on);  // pin 0 .. 7
+
+  int64_t get_freq() const { return freq.load(); }
+  int get_srate() const { return srate.load(); }
+  int get_direct_sampling() const { const int m = direct_sampling.load(); return (m == UNSET) ? 0 : m; }
+  int get_tuner_type() const;   // enum rtlsdr_tuner
+  uint32_t get_dev_idx() const { return dev_idx; }
+  const char* get_serial() const { return serial; }
+  int64_t get_sample_count() const { return sample_count.load(); }   // received I/Q pairs since start()
+
+  // number of opened contexts
+  static unsigned num_open();
+
+private:
+  RtlDevCtx() = default;
+  ~RtlDevCtx() = default;
+  RtlDevCtx(const RtlDevCtx&) = delete;
+  RtlDevCtx& operator=(const RtlDevCtx&) = delete;
+
+  struct Flags
+  {
+    static constexpr uint32_t freq = 1;
+    static constexpr uint32_t srate = 2;
+    static constexpr uint32_t gain = 4;
+    static constexpr uint32_t ppm = 8;
+    static constexpr uint32_t bias_tee = 16;
+    static constexpr uint32_t initial = 31;   // commanded at open
+    static constexpr uint32_t direct_sampling = 32;
+    static constexpr uint32_t offset_tuning = 64;
+    static constexpr uint32_t sideband = 128;
+    static constexpr uint32_t bandwidth = 256;
+    static constexpr uint32_t if_mode = 512;
+    static constexpr uint32_t rtl_agc = 1024;
+    static constexpr uint32_t band_center = 2048;
+    static constexpr uint32_t impulse_nc = 4096;
+    static constexpr uint32_t gpio = 8192;
+  };
+
+  // enum_lock: the enumeration lock - released after rtlsdr_open()
+  static RtlDevCtx* open_locked(uint32_t dev_idx, std::unique_lock<std::mutex>& enum_lock);
+
+  void set_value(std::atomic_int& v, int n, uint32_t f);
+
+  void trigger(uint32_t f);
+  void apply(uint32_t f);
+  static void rx_thread_proc(void* param);
+  static void control_thread_proc(void* param);
+  static void rx_callback(unsigned char* buf, uint32_t len, void* ctx);
+
+  rtlsdr_dev_t* dev = nullptr;
+  uint32_t dev_idx = 0;
+  char serial[256] = { 0 };
+
+  // requested settings
+  std::atomic_int64_t freq{ 100000000 };
+  std::atomic_int srate{ 2048000 };
+  std::atomic_int gain{ GAIN_AUTO };
+  std::atomic_int ppm{ 0 };
+  std::atomic_int bias_tee{ 0 };
+  std::atomic_int direct_sampling{ UNSET };
+  std::atomic_int offset_tuning{ UNSET };
+  std::atomic_int sideband{ UNSET };
+  std::atomic_int bandwidth{ UNSET };
+  std::atomic_int if_mode{ UNSET };
+  std::atomic_int rtl_agc{ UNSET };
+  std::atomic_int band_center{ UNSET };
+  std::atomic_int impulse_nc{ UNSET };
+  std::atomic_uint32_t gpio_used{ 0 };   // bit k: pin k is commanded
+  std::atomic_uint32_t gpio_val{ 0 };
+
+  // control thread
+  std::atomic_uint32_t pending{ 0 };
+  std::mutex apply_mutex;
+  void* control_event = nullptr;
+  volatile void* control_thread = nullptr;
+  std::atomic_bool terminate_control{ false };
+
+  // RX thread
+  SampleCallback callback = nullptr;
+  void* callback_user = nullptr;
+  uint32_t rx_buf_len = 0;
+  volatile void* rx_thread = nullptr;
+  std::atomic_bool rx_running{ false };
+  std::atomic_bool terminate_rx{ false };
+  alignas(64) std::atomic_int64_t sample_count{ 0 };
+};
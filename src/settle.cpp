@@ -0,0 +1,80 @@
+
+#include "settle.h"
+#include "tuners.h"
+
+#include <cstring>
+
+std::atomic_int settle_mode = 1;
+std::atomic_int settle_time_ms = -1;
+
+// RX thread's hot counters: own cache line
+alignas(64) std::atomic_int64_t rx_sample_count = 0;
+std::atomic_int64_t settle_change_at = -1;
+
+// first sample index after the settling window
+alignas(64) static std::atomic_int64_t settle_until = 0;
+static std::atomic_uint32_t settle_block_len = 0;   // I/Q pairs per USB transfer
+
+// completed transfers, which may still wait for the RX callback - in addition to the one filling
+static constexpr int64_t RX_QUEUED_BLOCKS = 1;
+
+
+void settle_reset(uint32_t block_iq_pairs, int64_t first_sample_idx)
+{
+  rx_sample_count = first_sample_idx;
+  settle_change_at = -1;
+  settle_until = 0;
+  settle_block_len = block_iq_pairs;
+}
+
+
+int64_t rx_block_after_change()
+{
+  // blocks are counted whole: rx_sample_count is at a block boundary
+  return rx_sample_count.load() + (1 + RX_QUEUED_BLOCKS) * int64_t(settle_block_len.load());
+}
+
+
+void settle_mark_change(unsigned tuner_no, int hw_samplerate)
+{
+  if (!settle_mode.load() || hw_samplerate <= 0)
+    return;
+  int ms = settle_time_ms.load();
+  if (ms < 0)
+    ms = tuners::settle_ms[(tuner_no < tuners::N) ? tuner_no : 0];
+  if (ms <= 0)
+    return;
+
+  // the change takes effect somewhere in the transfers in flight - not at rx_sample_count.
+  //   a 64 kB transfer is ~14 ms at 2.4 MSps: longer than most settling times.
+  //   the window covers all of them - also their samples from before the change - and
+  //   the settling time after the first block, which is received completely after the change
+  const int64_t at = rx_sample_count.load();
+  const int64_t until = rx_block_after_change() + int64_t(ms) * hw_samplerate / 1000;
+  settle_change_at = at;
+  // multiple changes: keep the later end
+  int64_t prev = settle_until.load();
+  while (prev < until && !settle_until.compare_exchange_weak(prev, until))
+    ;
+}
+
+
+bool settle_process_u8(uint8_t* iq, int n_iq_pairs)
+{
+  const int64_t start = rx_sample_count.load(std::memory_order_relaxed);
+  rx_sample_count.store(start + n_iq_pairs, std::memory_order_relaxed);
+
+  const int64_t until = settle_until.load(std::memory_order_relaxed);
+  if (until <= start)
+    return true;
+  const int mode = settle_mode.load(std::memory_order_relaxed);
+  if (!mode)
+    return true;
+
+  const int n_in = (until - start < n_iq_pairs) ? int(until - start) : n_iq_pairs;
+  if (mode == 2 && n_in == n_iq_pairs)
+    return false;
+  // 128 is zero after removing the offset
+  memset(iq, 128, 2 * size_t(n_in));
+  return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// settling window after retune or gain changes:
+//   PLL and AGC transients for some ms after a change shall not reach the host as valid samples.
+//   the control path records the received sample index, when a change took effect.
+//   the RX path then zeroes or drops the samples, up to the end of the settling window.
+
+// 0 == off: deliver all samples. 1 == zero samples in window. 2 == drop whole blocks in window
+extern std::atomic_int settle_mode;
+// settling time in ms. -1 == per tuner default: tuners::settle_ms[]
+extern std::atomic_int settle_time_ms;
+
+// RX thread: I/Q pairs received from USB since start of streaming
+extern std::atomic_int64_t rx_sample_count;
+// sample index of the last change, which opened a settling window
+extern std::atomic_int64_t settle_change_at;
+
+// before the RX thread starts. block_iq_pairs: I/Q pairs per USB transfer.
+//   first_sample_idx: rx_sample_count of the first block
+void settle_reset(uint32_t block_iq_pairs, int64_t first_sample_idx);
+
+// control path: sample index of the first block, which is received completely after
+//   a change commanded now. rx_sample_count only counts processed blocks: the change
+//   lands in a transfer, which libusb is still filling - or behind one waiting for the callback
+int64_t rx_block_after_change();
+
+// control path: after a successful retune or gain change.
+//   hw_samplerate: samplerate of received (not converted) I/Q pairs
+void settle_mark_change(unsigned tuner_no, int hw_samplerate);
+
+// RX thread: count and process n_iq_pairs received u8 I/Q pairs - before any conversion.
+//   returns false, when the whole block shall be dropped
+bool settle_process_u8(uint8_t* iq, int n_iq_pairs);
@@ -0,0 +1,196 @@
+
+#include "standby.h"
+#include "control.h"
+#include "rates.h"
+
+#include "LC_ExtIO_Types.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#define snprintf  _snprintf
+#endif
+
+/* ExtIO Callback */
+extern pfnExtIOCallback gpfnExtIOCallbackPtr;
+
+// error message, with "const char*" in IQdata,
+//   intended for a log file  AND  a message box
+#define SDRLOG( A, TEXT ) do { if ( gpfnExtIOCallbackPtr ) gpfnExtIOCallbackPtr(-1, A, 0, TEXT ); } while (0)
+#define SDRLG( A, TEXT, ...) do { if ( gpfnExtIOCallbackPtr ) { snprintf(acMsg, 255, TEXT, __VA_ARGS__); gpfnExtIOCallbackPtr(-1, A, 0, acMsg ); } } while (0)
+
+
+char standby_serial[256] = "";
+std::atomic_int standby_warm = 0;
+std::atomic_int standby_clip_permille = 0;
+
+static std::mutex standby_mutex;    // open/close vs. sync
+static RtlDevCtx* standby = nullptr;
+static int standby_tuner = -1;      // enum rtlsdr_tuner of the standby
+
+
+bool standby_open(const char* primary_serial)
+{
+  char acMsg[256];
+  std::lock_guard<std::mutex> lock(standby_mutex);
+  if (standby)
+    return true;
+  if (!standby_serial[0])
+    return false;
+  if (!strcmp(standby_serial, primary_serial))
+  {
+    SDRLG(extHw_MSG_ERROR, "standby: serial '%s' is the primary device", standby_serial);
+    return false;
+  }
+  standby = RtlDevCtx::open_serial(standby_serial);
+  if (!standby)
+    return false;
+  standby_tuner = standby->get_tuner_type();
+  SDRLG(extHw_MSG_DEBUG, "standby: device '%s' opened - tuner %d", standby_serial, standby_tuner);
+  return true;
+}
+
+void standby_close()
+{
+  std::lock_guard<std::mutex> lock(standby_mutex);
+  RtlDevCtx::close(standby);
+  standby = nullptr;
+}
+
+bool standby_is_open()
+{
+  return standby != nullptr;
+}
+
+const char* standby_get_serial()
+{
+  return standby_serial;
+}
+
+
+static bool is_r82xx(int t)
+{
+  return (RTLSDR_TUNER_R820T == t || RTLSDR_TUNER_R828D == t || RTLSDR_TUNER_BLOG_V4 == t);
+}
+
+// RtlDevCtx only commands changed values: everything is passed at each call
+void standby_sync()
+{
+  std::lock_guard<std::mutex> lock(standby_mutex);
+  if (!standby)
+    return;
+
+  ControlState n;
+  nxt.snapshot(n);
+  if (n.srate_idx < 0 || n.srate_idx >= int(rates::N))
+    return;
+  const int fs = rates::tab[n.srate_idx].valueInt;
+
+  // as Control_Changes() - for the standby's tuner, which matches the primary's
+  standby->set_direct_sampling(n.sampling_mode);
+  standby->set_srate(fs);
+  standby->set_ppm(n.freq_corr_ppm);
+  standby->set_band_center((n.band_center_sel == 1) ? fs / 4 : (n.band_center_sel == 2) ? -fs / 4 : 0);
+  standby->set_freq(int64_t(hw_center_freq(uint64_t(n.LO_freq), n.sampling_mode, n.srate_idx)));
+  if (n_bandwidths)
+    standby->set_bandwidth(n.tuner_bw * 1000);
+  if (!is_r82xx(standby_tuner))
+    standby->set_offset_tuning(n.offset_tuning);
+  standby->set_sideband(n.USB_sideband);
+  standby->set_gain((n.tuner_rf_agc) ? RtlDevCtx::GAIN_AUTO : n.rf_gain);
+  if (is_r82xx(standby_tuner))
+    standby->set_if_mode((n.tuner_if_agc) ? 0 : (10000 + n.if_gain_idx));
+  standby->set_rtl_agc(n.rtl_agc);
+  if (n.rtl_impulse_noise_cancellation == 0 || n.rtl_impulse_noise_cancellation == 1)
+    standby->set_impulse_nc(n.rtl_impulse_noise_cancellation);
+  for (unsigned k = 0; k < ControlVars::NUM_GPIO_BUTTONS; ++k)
+  {
+    if (!GPIO_en[k])
+      continue;
+    const int val = n.GPIO[k] ^ GPIO_inv[k];
+    if (GPIO_pin[k] < 0)
+      standby->set_bias_tee(val);
+    else
+      standby->set_gpio(unsigned(GPIO_pin[k]), val);
+  }
+}
+
+
+bool standby_can_take_over(const char*& why)
+{
+  std::lock_guard<std::mutex> lock(standby_mutex);
+  if (!standby)
+  {
+    why = "no standby";
+    return false;
+  }
+  // gains, bandwidths and IF modes are per tuner
+  //   the primary's tuner type from its open: tunerNo is reset at close - e.g. after the RX failure
+  if (standby_tuner != int(RtlOpenTunerType.load()))
+  {
+    why = "other tuner type";
+    return false;
+  }
+  // the RTL2832's analog AGC parameters are not mirrored: only at their defaults
+  ControlState n;
+  nxt.snapshot(n);
+  const int aagc[] = {
+    n.rtl_aagc_rf_en, n.rtl_aagc_rf_inv, n.rtl_aagc_rf_min, n.rtl_aagc_rf_max,
+    n.rtl_aagc_if_en, n.rtl_aagc_if_inv, n.rtl_aagc_if_min, n.rtl_aagc_if_max,
+    n.rtl_aagc_lg_lock, n.rtl_aagc_lg_unlock, n.rtl_aagc_lg_ifr,
+    n.rtl_aagc_vtop[0], n.rtl_aagc_vtop[1], n.rtl_aagc_vtop[2],
+    n.rtl_aagc_krf[0], n.rtl_aagc_krf[1], n.rtl_aagc_krf[2], n.rtl_aagc_krf[3]
+  };
+  for (int v : aagc)
+  {
+    if (v != -1)
+    {
+      why = "RTL AAGC not at defaults";
+      return false;
+    }
+  }
+  why = "";
+  return true;
+}
+
+
+int standby_get_sampling_mode()
+{
+  RtlDevCtx* s = standby;
+  return (s) ? s->get_direct_sampling() : 0;
+}
+
+
+int standby_start(RtlDevCtx::SampleCallback cb, uint32_t buf_len)
+{
+  std::lock_guard<std::mutex> lock(standby_mutex);
+  if (!standby)
+    return -1;
+  return standby->start(cb, nullptr, buf_len);
+}
+
+void standby_stop()
+{
+  std::lock_guard<std::mutex> lock(standby_mutex);
+  if (standby)
+    standby->stop();
+}
+
+bool standby_is_streaming()
+{
+  return standby && standby->is_streaming();
+}
+
+
+unsigned clip_permille(const uint8_t* iq, uint32_t n_bytes)
+{
+  if (!n_bytes)
+    return 0;
+  uint32_t n_clip = 0;
+  for (uint32_t k = 0; k < n_bytes; ++k)
+    n_clip += (iq[k] == 0 || iq[k] == 255) ? 1 : 0;
+  return unsigned(uint64_t(n_clip) * 1000 / n_bytes);
+}
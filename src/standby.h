@@ -0,0 +1,38 @@
+#pragma once
+
+#include "rtl_dev_ctx.h"
+
+#include <stdint.h>
+#include <atomic>
+
+// hot standby: a second dongle is kept open - configured like the primary device -
+//   to take over delivery, when the primary's RX fails or it clips.
+//   with standby_warm, the standby streams all the time and its samples are discarded
+//   until a failover: the switch then takes less than one block. without, it starts
+//   streaming at the failover - and can only take over at an RX failure.
+// the complete requested state (nxt) is mirrored - except the RTL2832's analog AGC parameters:
+//   no failover, when those differ from their defaults - or the standby has another tuner.
+
+extern char standby_serial[256];           // empty == no standby
+extern std::atomic_int standby_warm;
+extern std::atomic_int standby_clip_permille;   // clipping ADC samples for a failover. 0 == never
+
+// opens the standby device. not with the primary's serial
+bool standby_open(const char* primary_serial);
+void standby_close();
+bool standby_is_open();
+const char* standby_get_serial();
+
+// control path: apply changed requested values (nxt) to the standby
+void standby_sync();
+// can the standby deliver samples with the primary's configuration? else why not
+bool standby_can_take_over(const char*& why);
+// sampling mode of the standby: for the real to complex conversion after a failover
+int standby_get_sampling_mode();
+
+int standby_start(RtlDevCtx::SampleCallback cb, uint32_t buf_len);
+void standby_stop();
+bool standby_is_streaming();
+
+// per mille of u8 I/Q bytes at 0 or 255
+unsigned clip_permille(const uint8_t* iq, uint32_t n_bytes);
@@ -0,0 +1,141 @@
+
+#include "tuner_cache.h"
+#include "config_file.h"
+
+#include <windows.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+
+// one line per device: tuner_no TAB vendor TAB product TAB serial
+struct TunerCacheEntry
+{
+  uint32_t tuner_no;
+  std::string vendor;
+  std::string product;
+  std::string serial;
+};
+
+static constexpr size_t MAX_ENTRIES = 64;
+
+static std::mutex cache_mutex;
+static std::vector<TunerCacheEntry> entries;
+static bool loaded = false;
+
+
+static std::string cache_filename()
+{
+  return std::string(init_toml_config()) + ".tuners";
+}
+
+static bool is_entry(const TunerCacheEntry& e, const RtlDeviceInfo& dev)
+{
+  return e.serial == dev.serial && e.product == dev.product && e.vendor == dev.vendor;
+}
+
+static void load()
+{
+  loaded = true;
+  FILE* f = fopen(cache_filename().c_str(), "r");
+  if (!f)
+    return;
+  char line[1024];
+  while (entries.size() < MAX_ENTRIES && fgets(line, sizeof(line), f))
+  {
+    line[strcspn(line, "\r\n")] = 0;
+    char* field[4] = { line, nullptr, nullptr, nullptr };
+    for (int k = 1; k < 4 && field[k - 1]; ++k)
+    {
+      char* tab = strchr(field[k - 1], '\t');
+      if (tab)
+      {
+        *tab = 0;
+        field[k] = tab + 1;
+      }
+    }
+    if (!field[3])
+      continue;   // incomplete line
+    TunerCacheEntry e;
+    e.tuner_no = uint32_t(strtoul(field[0], nullptr, 10));
+    e.vendor = field[1];
+    e.product = field[2];
+    e.serial = field[3];
+    entries.push_back(e);
+  }
+  fclose(f);
+}
+
+static void save()
+{
+  // write complete file, then replace: a reader never sees a partial cache
+  const std::string fn = cache_filename();
+  const std::string tmp_fn = fn + ".tmp";
+  FILE* f = fopen(tmp_fn.c_str(), "w");
+  if (!f)
+    return;
+  bool ok = true;
+  for (const TunerCacheEntry& e : entries)
+    ok = ok && fprintf(f, "%u\t%s\t%s\t%s\n", unsigned(e.tuner_no), e.vendor.c_str(), e.product.c_str(), e.serial.c_str()) > 0;
+  ok = (fclose(f) == 0) && ok;
+  if (!ok || !MoveFileExA(tmp_fn.c_str(), fn.c_str(), MOVEFILE_REPLACE_EXISTING))
+    DeleteFileA(tmp_fn.c_str());
+}
+
+
+bool tuner_cache_lookup(const RtlDeviceInfo& dev, uint32_t& tuner_no)
+{
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  if (!loaded)
+    load();
+  for (const TunerCacheEntry& e : entries)
+  {
+    if (is_entry(e, dev))
+    {
+      tuner_no = e.tuner_no;
+      return true;
+    }
+  }
+  return false;
+}
+
+void tuner_cache_store(const RtlDeviceInfo& dev, uint32_t tuner_no)
+{
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  if (!loaded)
+    load();
+  // strings with line breaks or tabs can't be stored
+  for (const char* s : { dev.vendor, dev.product, dev.serial })
+  {
+    if (strpbrk(s, "\t\r\n"))
+      return;
+  }
+
+  size_t k = 0;
+  while (k < entries.size() && !is_entry(entries[k], dev))
+    ++k;
+  if (k < entries.size())
+  {
+    if (entries[k].tuner_no == tuner_no)
+      return;
+    entries.erase(entries.begin() + k);
+  }
+  else if (entries.size() >= MAX_ENTRIES)
+    entries.pop_back();   // least recently stored
+
+  // most recent first
+  TunerCacheEntry e;
+  e.tuner_no = tuner_no;
+  e.vendor = dev.vendor;
+  e.product = dev.product;
+  e.serial = dev.serial;
+  entries.insert(entries.begin(), e);
+  save();
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "control.h"
+
+#include <stdint.h>
+
+// tuner type per device - persisted across sessions in a file next to the config.
+//   with it, the GUI gets the tuner's gains and bandwidths before the device is opened
+//   and probed. key is vendor, product and serial: dongles sharing the default serial
+//   may get a wrong type - the probe at open corrects it.
+
+bool tuner_cache_lookup(const RtlDeviceInfo& dev, uint32_t& tuner_no);
+// writes the file, when the entry changed
+void tuner_cache_store(const RtlDeviceInfo& dev, uint32_t tuner_no);
@@ -67,6 +67,19 @@ const tuners::gain_t tuners::if_gains[tuners::N] =
 };
 
 
+const int tuners::settle_ms[tuners::N] =
+{
+  10  // tuner_type: unknown
+, 20  // E4000
+, 10  // FC0012
+, 10  // FC0013
+, 10  // FC2580
+, 5   // R820T/2
+, 5   // R828D
+, 10  // RTLSDR_TUNER_BLOG_V4: may also switch the upconverter / input
+};
+
+
 const tuners::bw_t tuners::bws[] =
 {
   { 0, 0 }  // tuner_type: E4000 =1, FC0012 =2, FC0013 =3, FC2580 =4, R820T =5, R828D =6
@@ -22,4 +22,6 @@ struct tuners
   static const gain_t if_gains[N];
   static const bw_t bws[N];
 
+  static const int settle_ms[N];   // PLL / AGC settling time after retune or gain change
+
 };